@@ -42,16 +42,33 @@
 #include "Scene2D.h"
 #include "Scene3D.h"
 #include "System/Clock.h"
+#include "System/MemoryPool.h"
+#include "System/ThreadPool.h"
 #include "System/Time.h"
 #include "Utils/Files.h"
+#include "Utils/BinaryStream.h"
 #include "Utils/IdStorage.h"
 #include "Utils/NoCopyable.h"
 #include "Utils/Singleton.h"
 #include "Utils/SparseSet.h"
 #include "Utils/VecUtils.h"
+#include "Voxel/BlockRegistry.h"
 #include "Voxel/Chunk.h"
+#include "Voxel/ChunkColliders.h"
+#include "Voxel/ChunkLod.h"
+#include "Voxel/ChunkOccupancy.h"
+#include "Voxel/ChunkSnapshot.h"
+#include "Voxel/ChunkMap.h"
 #include "Voxel/Chunks.h"
+#include "Voxel/EditJournal.h"
+#include "Voxel/Noise.h"
+#include "Voxel/NoiseCache.h"
+#include "Voxel/RegionFile.h"
+#include "Voxel/RegionStorage.h"
+#include "Voxel/Schematic.h"
 #include "Voxel/Voxel.h"
+#include "Voxel/VoxelCursor.h"
+#include "Voxel/VoxelStorage.h"
 #include "VoxelLigtning/LightSolver.h"
 #include "VoxelLigtning/Lightmap.h"
 #include "Window/Keyboard.h"
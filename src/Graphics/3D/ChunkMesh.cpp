@@ -1,6 +1,7 @@
 #include "ChunkMesh.h"
 #include "../../Voxel/Chunk.h"
 #include "../../Voxel/Chunks.h"
+#include "../../Voxel/VoxelCursor.h"
 #include "../Common/DefaultShaders.h"
 #include "../Common/RenderTarget.h"
 
@@ -69,22 +70,86 @@ static const glm::i32vec3 LEFT_SIDE_NEIGHBOURS[9] = {{-1, 0, 0},
                                                      {-1, -1, -1},
                                                      {-1, 0, -1}};
 
-void ChunkMesh::Light::calculate(Chunks *chunks,
-                                 const glm::i32vec3 &voxel_coords,
-                                 const glm::i32vec3 (&neighbours)[9])
+static bool isUniformOpaque(const BlockRegistry &block_registry, Chunk *chunk)
+{
+    return chunk && chunk->isUniform() && block_registry.isOpaque(chunk->getUniformVoxel().id);
+}
+
+// Writes per side and row of x voxels the bits of voxels whose neighbour on
+// that side is not opaque, sides in NEIGHBOURS order. Rows past the chunk are
+// read from the face neighbours, missing neighbours are not opaque.
+static void calculateExposedFaces(Chunks *chunks,
+                                  const glm::i32vec3 &chunk_coords,
+                                  const ChunkOccupancy &occupancy,
+                                  std::vector<uint64_t> &exposed)
+{
+    const glm::i32vec3 &size = chunks->getChunkSize();
+    const int32_t words_count = occupancy.getRowWordsCount();
+    const int32_t rows_words_count = size.y * size.z * words_count;
+    const std::vector<uint64_t> clear_row(words_count, 0);
+
+    const ChunkOccupancy *neighbours[6];
+    for (int32_t side = 0; side < 6; ++side) {
+        const Chunk *neighbour = chunks->getChunk(chunk_coords + NEIGHBOURS[side]);
+        neighbours[side] = neighbour ? &neighbour->getOccupancy() : nullptr;
+    }
+
+    auto opaque_row = [&](int32_t y, int32_t z) {
+        if (y >= 0 && y < size.y && z >= 0 && z < size.z)
+            return occupancy.getOpaqueRow(y, z);
+
+        const int32_t side = z >= size.z ? 0 : (z < 0 ? 1 : (y >= size.y ? 2 : 3));
+        return neighbours[side]
+                   ? neighbours[side]->getOpaqueRow((y + size.y) % size.y, (z + size.z) % size.z)
+                   : clear_row.data();
+    };
+
+    exposed.resize(6 * rows_words_count);
+    for (int32_t y = 0; y < size.y; ++y) {
+        for (int32_t z = 0; z < size.z; ++z) {
+            const int32_t row_offset = (y * size.z + z) * words_count;
+            const uint64_t *row = occupancy.getOpaqueRow(y, z);
+            const uint64_t *rows[4] = {opaque_row(y, z + 1),
+                                       opaque_row(y, z - 1),
+                                       opaque_row(y + 1, z),
+                                       opaque_row(y - 1, z)};
+
+            for (int32_t side = 0; side < 4; ++side)
+                for (int32_t word = 0; word < words_count; ++word)
+                    exposed[side * rows_words_count + row_offset + word] = ~rows[side][word];
+
+            // Neighbours along x are the row shifted by one voxel
+            for (int32_t word = 0; word < words_count; ++word) {
+                const uint64_t next = word + 1 < words_count ? row[word + 1] << 63 : 0;
+                const uint64_t previous = word > 0 ? row[word - 1] >> 63 : 0;
+                exposed[4 * rows_words_count + row_offset + word] = ~((row[word] >> 1) | next);
+                exposed[5 * rows_words_count + row_offset + word] = ~((row[word] << 1) | previous);
+            }
+
+            const int32_t last_x = size.x - 1;
+            if (neighbours[4] && (neighbours[4]->getOpaqueRow(y, z)[0] & 1))
+                exposed[4 * rows_words_count + row_offset + (last_x >> 6)] &=
+                    ~(uint64_t{1} << (last_x & 63));
+            if (neighbours[5] && neighbours[5]->isOpaque({last_x, y, z}))
+                exposed[5 * rows_words_count + row_offset] &= ~uint64_t{1};
+        }
+    }
+}
+
+void ChunkMesh::Light::calculate(const VoxelCursor &cursor, const glm::i32vec3 (&neighbours)[9])
 {
     for (int32_t i = 0; i < 4; ++i) {
-        float l = chunks->getLight(voxel_coords + neighbours[0], i);
+        float l = cursor.getLight(neighbours[0], i);
 
-        float a = chunks->getLight(voxel_coords + neighbours[1], i);
-        float b = chunks->getLight(voxel_coords + neighbours[2], i);
-        float c = chunks->getLight(voxel_coords + neighbours[3], i);
-        float d = chunks->getLight(voxel_coords + neighbours[4], i);
+        float a = cursor.getLight(neighbours[1], i);
+        float b = cursor.getLight(neighbours[2], i);
+        float c = cursor.getLight(neighbours[3], i);
+        float d = cursor.getLight(neighbours[4], i);
 
-        float e = chunks->getLight(voxel_coords + neighbours[5], i);
-        float f = chunks->getLight(voxel_coords + neighbours[6], i);
-        float g = chunks->getLight(voxel_coords + neighbours[7], i);
-        float h = chunks->getLight(voxel_coords + neighbours[8], i);
+        float e = cursor.getLight(neighbours[5], i);
+        float f = cursor.getLight(neighbours[6], i);
+        float g = cursor.getLight(neighbours[7], i);
+        float h = cursor.getLight(neighbours[8], i);
 
         ((reinterpret_cast<float *>(&p1))[i]) = (l * f0 + h + g + f) / f1;
         ((reinterpret_cast<float *>(&p2))[i]) = (l * f0 + f + e + d) / f1;
@@ -122,65 +187,134 @@ void ChunkMesh::create(Chunks *chunks, const glm::i32vec3 &chunk_coords)
 {
     float voxel_size = chunks->getVoxelSize();
     float texture_size = chunks->getTextureSize();
+    const BlockRegistry &block_registry = chunks->getBlockRegistry();
 
     Light light;
     std::vector<VoxelVertex> vertices;
     std::vector<uint32_t> indices;
 
+    // Uniform invisible chunks and uniform opaque chunks enclosed by uniform
+    // opaque neighbours have no visible faces
+    Chunk *chunk = chunks->getChunk(chunk_coords);
+    if (!chunk) {
+        m_vertex_array.setData(vertices, indices);
+        return;
+    }
+
+    if (chunk->isUniform()) {
+        const int32_t id = chunk->getUniformVoxel().id;
+        bool empty = !block_registry.isVisible(id);
+        if (!empty && block_registry.isOpaque(id)) {
+            empty = true;
+            for (const auto &neighbour : NEIGHBOURS)
+                empty = empty
+                        && isUniformOpaque(block_registry,
+                                           chunks->getChunk(chunk_coords + neighbour));
+        }
+
+        if (empty) {
+            m_vertex_array.setData(vertices, indices);
+            return;
+        }
+    }
+
+    std::vector<uint64_t> exposed;
+    calculateExposedFaces(chunks, chunk_coords, chunk->getOccupancy(), exposed);
+    const glm::i32vec3 &chunk_size = chunks->getChunkSize();
+    const int32_t words_count = chunk->getOccupancy().getRowWordsCount();
+    const int32_t rows_words_count = chunk_size.y * chunk_size.z * words_count;
+
     chunks->forEachVoxelsInChunk(
         chunk_coords,
-        [this, &chunks, &voxel_size, &texture_size, &light, &vertices, &indices](
-            const glm::i32vec3 &voxel_coords_in_chunk, const glm::i32vec3 &voxel_coords) {
-            auto *voxel = chunks->getVoxel(voxel_coords);
-
-            if (voxel->id == 0)
+        [this,
+         &chunks,
+         &chunk,
+         &block_registry,
+         &voxel_size,
+         &texture_size,
+         &light,
+         &vertices,
+         &indices,
+         &exposed,
+         &chunk_size,
+         words_count,
+         rows_words_count](const glm::i32vec3 &voxel_coords_in_chunk,
+                           const glm::i32vec3 &,
+                           const Voxel &voxel) {
+            if (!block_registry.isVisible(voxel.id))
                 return;
 
-            auto uv = m_material.diffuse_texture0->getUVRect(
-                {texture_size * (voxel->id - 1), 0, texture_size, texture_size});
+            const int32_t word = (voxel_coords_in_chunk.y * chunk_size.z + voxel_coords_in_chunk.z)
+                                     * words_count
+                                 + (voxel_coords_in_chunk.x >> 6);
+            const int32_t bit = voxel_coords_in_chunk.x & 63;
+            auto isExposed = [&exposed, rows_words_count, word, bit](int32_t side) {
+                return (exposed[side * rows_words_count + word] >> bit) & 1;
+            };
+
+            auto uv = [this, &block_registry, &texture_size, &voxel](BlockFace face) {
+                return m_material.diffuse_texture0->getUVRect(
+                    {texture_size * block_registry.getFaceTile(voxel.id, face),
+                     0,
+                     texture_size,
+                     texture_size});
+            };
 
             glm::vec3 offset = static_cast<glm::vec3>(voxel_coords_in_chunk) * voxel_size;
+            const VoxelCursor cursor{chunks, chunk, voxel_coords_in_chunk};
 
             // Z+ Front side
-            if (!chunks->isVoxelBlocked(voxel_coords + FRONT_SIDE_NEIGHBOURS[0])) {
-                light.calculate(chunks, voxel_coords, FRONT_SIDE_NEIGHBOURS);
-                createFrontSide(vertices, indices, offset, uv, voxel_size, light);
+            if (isExposed(0)) {
+                light.calculate(cursor, FRONT_SIDE_NEIGHBOURS);
+                createFrontSide(
+                    vertices, indices, offset, uv(BlockFace::FRONT), voxel_size, light);
             }
 
             // Z- Back side
-            if (!chunks->isVoxelBlocked(voxel_coords + BACK_SIDE_NEIGHBOURS[0])) {
-                light.calculate(chunks, voxel_coords, BACK_SIDE_NEIGHBOURS);
-                createBackSide(vertices, indices, offset, uv, voxel_size, light);
+            if (isExposed(1)) {
+                light.calculate(cursor, BACK_SIDE_NEIGHBOURS);
+                createBackSide(vertices, indices, offset, uv(BlockFace::BACK), voxel_size, light);
             }
 
             // Y+ Up side
-            if (!chunks->isVoxelBlocked(voxel_coords + UP_SIDE_NEIGHBOURS[0])) {
-                light.calculate(chunks, voxel_coords, UP_SIDE_NEIGHBOURS);
-                createUpSide(vertices, indices, offset, uv, voxel_size, light);
+            if (isExposed(2)) {
+                light.calculate(cursor, UP_SIDE_NEIGHBOURS);
+                createUpSide(vertices, indices, offset, uv(BlockFace::UP), voxel_size, light);
             }
 
             // Y- Down side
-            if (!chunks->isVoxelBlocked(voxel_coords + DOWN_SIDE_NEIGHBOURS[0])) {
-                light.calculate(chunks, voxel_coords, DOWN_SIDE_NEIGHBOURS);
-                createDownSide(vertices, indices, offset, uv, voxel_size, light);
+            if (isExposed(3)) {
+                light.calculate(cursor, DOWN_SIDE_NEIGHBOURS);
+                createDownSide(vertices, indices, offset, uv(BlockFace::DOWN), voxel_size, light);
             }
 
             // X+ Right side
-            if (!chunks->isVoxelBlocked(voxel_coords + RIGHT_SIDE_NEIGHBOURS[0])) {
-                light.calculate(chunks, voxel_coords, RIGHT_SIDE_NEIGHBOURS);
-                createRightSide(vertices, indices, offset, uv, voxel_size, light);
+            if (isExposed(4)) {
+                light.calculate(cursor, RIGHT_SIDE_NEIGHBOURS);
+                createRightSide(
+                    vertices, indices, offset, uv(BlockFace::RIGHT), voxel_size, light);
             }
 
             // X- Left side
-            if (!chunks->isVoxelBlocked(voxel_coords + LEFT_SIDE_NEIGHBOURS[0])) {
-                light.calculate(chunks, voxel_coords, LEFT_SIDE_NEIGHBOURS);
-                createLeftSide(vertices, indices, offset, uv, voxel_size, light);
+            if (isExposed(5)) {
+                light.calculate(cursor, LEFT_SIDE_NEIGHBOURS);
+                createLeftSide(vertices, indices, offset, uv(BlockFace::LEFT), voxel_size, light);
             }
         });
 
     m_vertex_array.setData(vertices, indices);
 }
 
+size_t ChunkMesh::getCpuMemoryUsage() const
+{
+    return sizeof(ChunkMesh);
+}
+
+size_t ChunkMesh::getGpuMemoryUsage() const
+{
+    return m_vertex_array.getMemoryUsage();
+}
+
 void ChunkMesh::draw(const RenderState &render_state) const {}
 
 // void ChunkMesh::draw(const RenderTarget &render_target, const RenderState3D &render_state) const
@@ -13,6 +13,7 @@ namespace eb {
 
 class Chunk;
 class Chunks;
+class VoxelCursor;
 
 struct VoxelVertex
 {
@@ -39,9 +40,7 @@ public:
         void fill(const glm::vec4 &light) { p1 = p2 = p3 = p4 = light; }
         void clear() { p1 = p2 = p3 = p4 = {0.0f, 0.0f, 0.0f, 1.0f}; }
 
-        void calculate(Chunks *chunks,
-                       const glm::i32vec3 &voxel_coords,
-                       const glm::i32vec3 (&neighbours)[9]);
+        void calculate(const VoxelCursor &cursor, const glm::i32vec3 (&neighbours)[9]);
 
         glm::vec4 p1;
         glm::vec4 p2;
@@ -61,6 +60,11 @@ public:
 
     void create(Chunks *chunks, const glm::i32vec3 &chunk_coords);
 
+    // Geometry is uploaded right after meshing and not kept on the CPU, the
+    // CPU side is the mesh object itself
+    size_t getCpuMemoryUsage() const;
+    size_t getGpuMemoryUsage() const;
+
     void draw(const RenderState &render_state) const;
     // void draw(const RenderTarget &render_target, const RenderState3D &render_state) const;
 
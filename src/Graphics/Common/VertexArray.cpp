@@ -32,6 +32,11 @@ int32_t VertexArray::getIndicesCount() const
     return m_indices_count;
 }
 
+size_t VertexArray::getMemoryUsage() const
+{
+    return static_cast<size_t>(m_vbo.getSize()) + static_cast<size_t>(m_ebo.getSize());
+}
+
 bool VertexArray::isValid() const
 {
     return m_valid;
@@ -19,6 +19,8 @@ public:
     UsageType getUsageType() const;
     int32_t getVertexCount() const;
     int32_t getIndicesCount() const;
+    // Bytes allocated for the vertex and index buffers on the GPU
+    size_t getMemoryUsage() const;
     bool isValid() const;
 
     template<typename V, int32_t... Is>
@@ -0,0 +1,107 @@
+#include "MemoryPool.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace eb {
+
+MemoryPool::MemoryPool()
+    : m_slabs_bytes{0}
+    , m_allocations_count{0}
+    , m_reused_count{0}
+{}
+
+MemoryPool::~MemoryPool()
+{
+    for (void *slab : m_slabs)
+        ::operator delete(slab, std::align_val_t{ALIGNMENT});
+}
+
+void *MemoryPool::allocate(size_t size)
+{
+    const size_t block_size = toBlockSize(size);
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    SizeClass &size_class = m_size_classes[block_size];
+    ++m_allocations_count;
+    if (size_class.free_blocks)
+        ++m_reused_count;
+    else
+        addSlab(block_size, size_class);
+
+    FreeBlock *block = size_class.free_blocks;
+    size_class.free_blocks = block->next;
+    --size_class.free_count;
+    ++size_class.used_count;
+    return block;
+}
+
+void MemoryPool::deallocate(void *block, size_t size)
+{
+    if (!block)
+        return;
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    SizeClass &size_class = m_size_classes[toBlockSize(size)];
+    FreeBlock *free_block = new (block) FreeBlock{size_class.free_blocks};
+    size_class.free_blocks = free_block;
+    ++size_class.free_count;
+    --size_class.used_count;
+}
+
+MemoryPool::Stats MemoryPool::getStats() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+
+    Stats stats;
+    stats.size_classes_count = m_size_classes.size();
+    stats.slabs_count = m_slabs.size();
+    stats.slabs_bytes = m_slabs_bytes;
+    stats.allocations_count = m_allocations_count;
+    stats.reused_count = m_reused_count;
+    for (const auto &[block_size, size_class] : m_size_classes) {
+        stats.used_blocks_count += size_class.used_count;
+        stats.used_bytes += size_class.used_count * block_size;
+        stats.free_blocks_count += size_class.free_count;
+        stats.free_bytes += size_class.free_count * block_size;
+    }
+    return stats;
+}
+
+void MemoryPool::logStats() const
+{
+    const Stats stats = getStats();
+    spdlog::debug("Memory pool: {} slabs, {} KiB used, {} KiB free, {} size classes, "
+                  "{} of {} allocations reused",
+                  stats.slabs_count,
+                  stats.used_bytes / 1024,
+                  stats.free_bytes / 1024,
+                  stats.size_classes_count,
+                  stats.reused_count,
+                  stats.allocations_count);
+}
+
+size_t MemoryPool::toBlockSize(size_t size)
+{
+    size = std::max(size, sizeof(FreeBlock));
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+void MemoryPool::addSlab(size_t block_size, SizeClass &size_class)
+{
+    // Blocks larger than a slab get a slab of their own
+    const size_t blocks_count = std::max<size_t>(SLAB_SIZE / block_size, 1);
+    auto *slab = static_cast<uint8_t *>(
+        ::operator new(blocks_count * block_size, std::align_val_t{ALIGNMENT}));
+    m_slabs.push_back(slab);
+    m_slabs_bytes += blocks_count * block_size;
+
+    for (size_t i = blocks_count; i-- > 0;) {
+        FreeBlock *block = new (slab + i * block_size) FreeBlock{size_class.free_blocks};
+        size_class.free_blocks = block;
+    }
+    size_class.free_count += blocks_count;
+}
+
+} // namespace eb
@@ -0,0 +1,144 @@
+#ifndef EB_SYSTEM_MEMORYPOOL_H
+#define EB_SYSTEM_MEMORYPOOL_H
+
+#include "../Utils/Singleton.h"
+
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eb {
+
+// Block allocator for chunk objects and arrays. Requests are rounded up to
+// ALIGNMENT and every rounded size has a free list fed from slabs of several
+// blocks. Freed blocks are kept for reuse and slabs are only released with
+// the pool, so once warm, loading and unloading chunks stops calling the
+// system allocator. Thread safe.
+class MemoryPool : public Singleton<MemoryPool>
+{
+public:
+    struct Stats
+    {
+        size_t size_classes_count = 0;
+        size_t slabs_count = 0;
+        size_t slabs_bytes = 0;
+        size_t used_blocks_count = 0;
+        size_t used_bytes = 0;
+        size_t free_blocks_count = 0;
+        size_t free_bytes = 0;
+        uint64_t allocations_count = 0;
+        // Allocations served from free lists without a new slab
+        uint64_t reused_count = 0;
+    };
+
+    static constexpr size_t ALIGNMENT = 16;
+    static constexpr size_t SLAB_SIZE = 256 * 1024;
+
+    MemoryPool();
+    ~MemoryPool();
+
+    void *allocate(size_t size);
+    void deallocate(void *block, size_t size);
+
+    Stats getStats() const;
+    void logStats() const;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    struct SizeClass
+    {
+        FreeBlock *free_blocks = nullptr;
+        size_t free_count = 0;
+        size_t used_count = 0;
+    };
+
+    static size_t toBlockSize(size_t size);
+    void addSlab(size_t block_size, SizeClass &size_class);
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<size_t, SizeClass> m_size_classes;
+    std::vector<void *> m_slabs;
+    size_t m_slabs_bytes;
+    uint64_t m_allocations_count;
+    uint64_t m_reused_count;
+};
+
+// Stateless allocator over the memory pool for standard containers
+template<typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &)
+    {}
+
+    T *allocate(size_t count)
+    {
+        static_assert(alignof(T) <= MemoryPool::ALIGNMENT);
+        return static_cast<T *>(MemoryPool::getInstance().allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T *block, size_t count)
+    {
+        MemoryPool::getInstance().deallocate(block, count * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U> &) const
+    {
+        return true;
+    }
+};
+
+template<typename T>
+using PoolVector = std::vector<T, PoolAllocator<T>>;
+
+template<typename T>
+struct PoolDeleter
+{
+    void operator()(T *object) const
+    {
+        object->~T();
+        MemoryPool::getInstance().deallocate(object, sizeof(T));
+    }
+};
+
+// Owns an object of exactly type T living in the memory pool
+template<typename T>
+using PoolPtr = std::unique_ptr<T, PoolDeleter<T>>;
+
+template<typename T, typename... Args>
+PoolPtr<T> makePooled(Args &&...args)
+{
+    static_assert(alignof(T) <= MemoryPool::ALIGNMENT);
+    void *block = MemoryPool::getInstance().allocate(sizeof(T));
+    try {
+        return PoolPtr<T>{new (block) T(std::forward<Args>(args)...)};
+    } catch (...) {
+        MemoryPool::getInstance().deallocate(block, sizeof(T));
+        throw;
+    }
+}
+
+template<typename T, typename... Args>
+std::shared_ptr<T> makeSharedPooled(Args &&...args)
+{
+    return std::allocate_shared<T>(PoolAllocator<T>{}, std::forward<Args>(args)...);
+}
+
+} // namespace eb
+
+#endif // EB_SYSTEM_MEMORYPOOL_H
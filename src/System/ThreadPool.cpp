@@ -0,0 +1,83 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace eb {
+
+ThreadPool::ThreadPool(int32_t threads_count)
+    : m_active_tasks{0}
+    , m_stop{false}
+{
+    if (threads_count <= 0)
+        threads_count = std::max(static_cast<int32_t>(std::thread::hardware_concurrency()), 1);
+
+    m_threads.reserve(threads_count);
+    for (int32_t i = 0; i < threads_count; ++i)
+        m_threads.emplace_back(&ThreadPool::run, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_task_condition.notify_all();
+
+    for (auto &thread : m_threads)
+        thread.join();
+}
+
+int32_t ThreadPool::getThreadsCount() const
+{
+    return m_threads.size();
+}
+
+int32_t ThreadPool::getPendingTasksCount() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_tasks.size() + m_active_tasks;
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_tasks.push(std::move(task));
+    }
+    m_task_condition.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    m_idle_condition.wait(lock, [this]() { return m_tasks.empty() && m_active_tasks == 0; });
+}
+
+void ThreadPool::run()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{m_mutex};
+            m_task_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+            ++m_active_tasks;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            --m_active_tasks;
+            if (m_tasks.empty() && m_active_tasks == 0)
+                m_idle_condition.notify_all();
+        }
+    }
+}
+
+} // namespace eb
@@ -0,0 +1,44 @@
+#ifndef EB_SYSTEM_THREADPOOL_H
+#define EB_SYSTEM_THREADPOOL_H
+
+#include "../Utils/NoCopyable.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace eb {
+
+class ThreadPool : public NoCopyable
+{
+public:
+    // Zero threads count uses all hardware threads
+    ThreadPool(int32_t threads_count = 0);
+    ~ThreadPool();
+
+    int32_t getThreadsCount() const;
+    int32_t getPendingTasksCount() const;
+
+    void enqueue(std::function<void()> task);
+    void wait();
+
+private:
+    void run();
+
+private:
+    std::vector<std::thread> m_threads;
+    std::queue<std::function<void()>> m_tasks;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_task_condition;
+    std::condition_variable m_idle_condition;
+    int32_t m_active_tasks;
+    bool m_stop;
+};
+
+} // namespace eb
+
+#endif // EB_SYSTEM_THREADPOOL_H
@@ -0,0 +1,125 @@
+#ifndef EB_UTILS_BINARYSTREAM_H
+#define EB_UTILS_BINARYSTREAM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace eb {
+
+class BinaryWriter
+{
+public:
+    BinaryWriter(std::vector<uint8_t> &data)
+        : m_data{data}
+    {}
+    ~BinaryWriter() = default;
+
+    std::vector<uint8_t> &getData() { return m_data; }
+
+    void writeU8(uint8_t value) { m_data.push_back(value); }
+
+    template<typename T>
+    void write(const T &value)
+    {
+        size_t offset = m_data.size();
+        m_data.resize(offset + sizeof(T));
+        memcpy(m_data.data() + offset, &value, sizeof(T));
+    }
+
+    void writeBytes(const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        m_data.insert(m_data.end(), bytes, bytes + size);
+    }
+
+    void writeVarUInt(uint64_t value)
+    {
+        while (value >= 0x80) {
+            m_data.push_back(static_cast<uint8_t>(value) | 0x80);
+            value >>= 7;
+        }
+        m_data.push_back(static_cast<uint8_t>(value));
+    }
+
+    void writeVarInt(int64_t value)
+    {
+        writeVarUInt((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+private:
+    std::vector<uint8_t> &m_data;
+};
+
+class BinaryReader
+{
+public:
+    BinaryReader(const uint8_t *data, size_t size)
+        : m_data{data}
+        , m_end{data + size}
+        , m_valid{true}
+    {}
+    ~BinaryReader() = default;
+
+    bool isValid() const { return m_valid; }
+    bool isEnd() const { return m_data == m_end; }
+    size_t getRemaining() const { return m_end - m_data; }
+    const uint8_t *getPosition() const { return m_data; }
+
+    uint8_t readU8()
+    {
+        if (m_data == m_end) {
+            m_valid = false;
+            return 0;
+        }
+        return *m_data++;
+    }
+
+    template<typename T>
+    T read()
+    {
+        T value{};
+        readBytes(&value, sizeof(T));
+        return value;
+    }
+
+    bool readBytes(void *data, size_t size)
+    {
+        if (getRemaining() < size) {
+            m_valid = false;
+            m_data = m_end;
+            return false;
+        }
+        memcpy(data, m_data, size);
+        m_data += size;
+        return true;
+    }
+
+    uint64_t readVarUInt()
+    {
+        uint64_t value = 0;
+        for (int32_t shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = readU8();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        m_valid = false;
+        return 0;
+    }
+
+    int64_t readVarInt()
+    {
+        uint64_t value = readVarUInt();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+private:
+    const uint8_t *m_data;
+    const uint8_t *m_end;
+    bool m_valid;
+};
+
+} // namespace eb
+
+#endif // EB_UTILS_BINARYSTREAM_H
@@ -3,8 +3,30 @@
 
 #include <glm/glm.hpp>
 
+#include <bit>
+
 namespace eb {
 
+inline int32_t floorDiv(int32_t value, int32_t divider)
+{
+    return value / divider - ((value % divider) < 0);
+}
+
+inline bool isPowerOfTwo(const glm::i32vec3 &vec)
+{
+    return vec.x > 0 && vec.y > 0 && vec.z > 0 && std::has_single_bit(static_cast<uint32_t>(vec.x))
+           && std::has_single_bit(static_cast<uint32_t>(vec.y))
+           && std::has_single_bit(static_cast<uint32_t>(vec.z));
+}
+
+// Per axis log2 of a power of two vector
+inline glm::i32vec3 log2PowerOfTwo(const glm::i32vec3 &vec)
+{
+    return {std::countr_zero(static_cast<uint32_t>(vec.x)),
+            std::countr_zero(static_cast<uint32_t>(vec.y)),
+            std::countr_zero(static_cast<uint32_t>(vec.z))};
+}
+
 template<typename T, typename U>
 T moveVec(const T &vec, const U &x, const U &y, const U &z)
 {
@@ -0,0 +1,104 @@
+#include "BlockRegistry.h"
+
+#include <algorithm>
+
+namespace eb {
+
+BlockRegistry::BlockRegistry()
+    : m_version{0}
+{
+    resize(DEFAULT_BLOCKS_COUNT);
+
+    BlockType air;
+    air.name = "air";
+    air.visible = false;
+    air.opaque = false;
+    air.solid = false;
+    set(0, air);
+}
+
+int32_t BlockRegistry::getBlocksCount() const
+{
+    return m_names.size();
+}
+
+uint32_t BlockRegistry::getVersion() const
+{
+    return m_version;
+}
+
+void BlockRegistry::set(int32_t id, const BlockType &type)
+{
+    assert(id >= 0);
+    ++m_version;
+    if (id >= getBlocksCount())
+        resize(id + 1);
+
+    m_names[id] = type.name;
+    m_visible[id] = type.visible;
+    m_opaque[id] = type.opaque;
+    m_solid[id] = type.solid;
+    for (int32_t channel = 0; channel < 3; ++channel)
+        m_emission[id * 4 + channel] = std::min<uint8_t>(type.emission[channel], 15);
+    m_attenuation[id] = std::max<uint8_t>(type.attenuation, 1);
+    std::copy(type.face_tiles.begin(), type.face_tiles.end(), m_face_tiles.begin() + id * 6);
+}
+
+int32_t BlockRegistry::add(const BlockType &type)
+{
+    int32_t id = getBlocksCount();
+    set(id, type);
+    return id;
+}
+
+int32_t BlockRegistry::find(const std::string &name) const
+{
+    auto it = std::find(m_names.begin(), m_names.end(), name);
+    return it == m_names.end() ? -1 : static_cast<int32_t>(it - m_names.begin());
+}
+
+BlockType BlockRegistry::get(int32_t id) const
+{
+    BlockType type;
+    if (!isKnown(id)) {
+        type.face_tiles.fill(getFaceTile(id, BlockFace::FRONT));
+        return type;
+    }
+
+    type.name = m_names[id];
+    type.visible = m_visible[id];
+    type.opaque = m_opaque[id];
+    type.solid = m_solid[id];
+    for (int32_t channel = 0; channel < 3; ++channel)
+        type.emission[channel] = m_emission[id * 4 + channel];
+    type.attenuation = m_attenuation[id];
+    std::copy(m_face_tiles.begin() + id * 6,
+              m_face_tiles.begin() + id * 6 + 6,
+              type.face_tiles.begin());
+    return type;
+}
+
+const std::string &BlockRegistry::getName(int32_t id) const
+{
+    static const std::string unknown_name;
+    return isKnown(id) ? m_names[id] : unknown_name;
+}
+
+void BlockRegistry::resize(int32_t size)
+{
+    const int32_t old_size = getBlocksCount();
+
+    m_names.resize(size);
+    m_visible.resize(size, 1);
+    m_opaque.resize(size, 1);
+    m_solid.resize(size, 1);
+    m_emission.resize(size * 4, 0);
+    m_attenuation.resize(size, 1);
+    m_face_tiles.resize(size * 6);
+
+    // Default blocks use one atlas tile per id on every face
+    for (int32_t id = std::max(old_size, 1); id < size; ++id)
+        std::fill(m_face_tiles.begin() + id * 6, m_face_tiles.begin() + id * 6 + 6, id - 1);
+}
+
+} // namespace eb
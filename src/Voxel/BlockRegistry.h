@@ -0,0 +1,122 @@
+#ifndef EB_VOXEL_BLOCKREGISTRY_H
+#define EB_VOXEL_BLOCKREGISTRY_H
+
+#include <array>
+#include <assert.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace eb {
+
+// Same order as the chunk mesh sides
+enum class BlockFace { FRONT, BACK, UP, DOWN, RIGHT, LEFT };
+
+struct BlockType
+{
+    std::string name;
+    // Drawn by the chunk mesh
+    bool visible = true;
+    // Hides neighbour faces and stops light
+    bool opaque = true;
+    // Collides and stops ray casts
+    bool solid = true;
+    // Emitted light per channel R, G, B, 0-15
+    std::array<uint8_t, 3> emission{0, 0, 0};
+    // Light lost when passing through the block, at least 1
+    uint8_t attenuation = 1;
+    // Atlas tile per BlockFace
+    std::array<uint16_t, 6> face_tiles{0, 0, 0, 0, 0, 0};
+};
+
+// Block properties indexed by voxel id, every property is kept in its own
+// flat array so hot loops read one value per lookup
+class BlockRegistry
+{
+public:
+    // Ids without a registered type are opaque solid blocks using tile id - 1,
+    // id 0 is air. Ids past the tables, as read from old or corrupted saves,
+    // get the same defaults.
+    static constexpr int32_t DEFAULT_BLOCKS_COUNT = 256;
+
+    BlockRegistry();
+    ~BlockRegistry() = default;
+
+    int32_t getBlocksCount() const;
+    // Bumped by every change, data derived from block properties compares it
+    uint32_t getVersion() const;
+
+    // Sets the type of the id, growing the tables when needed
+    void set(int32_t id, const BlockType &type);
+    // Registers the type under a new id past all existing ones
+    int32_t add(const BlockType &type);
+    // Id of the named type or -1
+    int32_t find(const std::string &name) const;
+
+    BlockType get(int32_t id) const;
+    const std::string &getName(int32_t id) const;
+
+    bool isVisible(int32_t id) const;
+    bool isOpaque(int32_t id) const;
+    bool isSolid(int32_t id) const;
+    uint8_t getEmission(int32_t id, int32_t channel) const;
+    uint8_t getAttenuation(int32_t id) const;
+    uint16_t getFaceTile(int32_t id, BlockFace face) const;
+
+private:
+    bool isKnown(int32_t id) const;
+    void resize(int32_t size);
+
+private:
+    uint32_t m_version;
+    std::vector<std::string> m_names;
+    std::vector<uint8_t> m_visible;
+    std::vector<uint8_t> m_opaque;
+    std::vector<uint8_t> m_solid;
+    // Four channels per id, the sky channel never emits
+    std::vector<uint8_t> m_emission;
+    std::vector<uint8_t> m_attenuation;
+    std::vector<uint16_t> m_face_tiles;
+};
+
+inline bool BlockRegistry::isKnown(int32_t id) const
+{
+    return static_cast<uint32_t>(id) < m_visible.size();
+}
+
+inline bool BlockRegistry::isVisible(int32_t id) const
+{
+    return !isKnown(id) || m_visible[id];
+}
+
+inline bool BlockRegistry::isOpaque(int32_t id) const
+{
+    return !isKnown(id) || m_opaque[id];
+}
+
+inline bool BlockRegistry::isSolid(int32_t id) const
+{
+    return !isKnown(id) || m_solid[id];
+}
+
+inline uint8_t BlockRegistry::getEmission(int32_t id, int32_t channel) const
+{
+    assert(channel >= 0 && channel < 4);
+    return isKnown(id) ? m_emission[id * 4 + channel] : 0;
+}
+
+inline uint8_t BlockRegistry::getAttenuation(int32_t id) const
+{
+    return isKnown(id) ? m_attenuation[id] : 1;
+}
+
+inline uint16_t BlockRegistry::getFaceTile(int32_t id, BlockFace face) const
+{
+    if (!isKnown(id))
+        return id > 0 ? static_cast<uint16_t>(id - 1) : 0;
+    return m_face_tiles[id * 6 + static_cast<int32_t>(face)];
+}
+
+} // namespace eb
+
+#endif // EB_VOXEL_BLOCKREGISTRY_H
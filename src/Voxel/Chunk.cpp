@@ -1,19 +1,38 @@
 #include "Chunk.h"
 #include "Chunks.h"
+#include "../System/Clock.h"
+#include "../Utils/BinaryStream.h"
 
 #include <glm/gtc/noise.hpp>
 #include <spdlog/spdlog.h>
 
+#include <atomic>
+
 namespace eb {
 
+static uint64_t nextVersion()
+{
+    static std::atomic<uint64_t> version{0};
+    return ++version;
+}
+
 Chunk::Chunk(const glm::i32vec3 &position, Chunks *chunks)
     : m_chunks{chunks}
     , m_position{position}
-    , m_light_map{chunks->getChunkSize()}
+    , m_size{chunks->getChunkSize()}
+    , m_voxels{makeSharedPooled<VoxelStorage>(m_size.x * m_size.y * m_size.z)}
+    , m_light_map{makeSharedPooled<Lightmap>(m_size)}
+    , m_version{nextVersion()}
+    , m_voxels_version{m_version}
+    , m_occupancy{m_size, chunks->getBlockRegistry()}
     , m_modified{false}
+    , m_unsaved{true}
+    , m_dormant{false}
+    , m_dormant_raw_size{0}
+    , m_touch_time{0}
 {
-    auto &chunk_size = chunks->getChunkSize();
-    m_voxels.resize(chunk_size.x * chunk_size.y * chunk_size.z, Voxel{0});
+    m_neighbours.fill(nullptr);
+    m_neighbours[neighbourToIndex(glm::i32vec3{0})] = this;
 }
 
 Chunks *Chunk::getChunks() const
@@ -26,28 +45,233 @@ const glm::i32vec3 &Chunk::getPosition() const
     return m_position;
 }
 
-const Voxel *Chunk::getVoxel(const glm::i32vec3 &voxel_coords) const
+const glm::i32vec3 &Chunk::getSize() const
 {
-    int32_t index = voxelCoordsToIndex(voxel_coords);
-    return (index < 0 || index >= m_voxels.size()) ? nullptr : &m_voxels[index];
+    return m_size;
 }
 
-void Chunk::setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel)
+bool Chunk::setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel)
 {
-    m_voxels[voxelCoordsToIndex(voxel_coords)] = voxel;
+    const int32_t index = voxelCoordsToIndex(voxel_coords);
+    const Voxel old_voxel = getVoxels().get(index);
+    if (old_voxel.id == voxel.id)
+        return false;
+
+    getMutableVoxels().set(index, voxel);
+    updateSummaries(voxel_coords, old_voxel, voxel);
+
     m_modified = true;
+    m_unsaved = true;
     m_chunks->m_chunks_modfied = true;
+    return true;
+}
+
+bool Chunk::isUniform() const
+{
+    // compress() keeps uniform chunks resident
+    return !m_dormant.load(std::memory_order_acquire) && m_voxels->isUniform();
+}
+
+Voxel Chunk::getUniformVoxel() const
+{
+    return m_dormant.load(std::memory_order_acquire) ? Voxel{} : m_voxels->getPalette().front();
+}
+
+Lightmap &Chunk::getMutableLightmap()
+{
+    wake();
+    if (m_light_map.use_count() > 1)
+        m_light_map = makeSharedPooled<Lightmap>(*m_light_map);
+    m_version = nextVersion();
+    return *m_light_map;
+}
+
+void Chunk::collapseLightmap()
+{
+    if (!m_dormant.load(std::memory_order_acquire) && m_light_map.use_count() == 1
+        && !m_light_map->isUniform())
+        m_light_map->collapse();
+}
+
+uint64_t Chunk::getVersion() const
+{
+    return m_version;
+}
+
+uint64_t Chunk::getVoxelsVersion() const
+{
+    return m_voxels_version;
+}
+
+ChunkSnapshot::Entry Chunk::getSnapshotEntry() const
+{
+    wake();
+    return {m_version, m_voxels, m_light_map};
+}
+
+bool Chunk::hasLod() const
+{
+    return m_lod != nullptr;
+}
+
+const ChunkLod &Chunk::getLod() const
+{
+    if (!m_lod) {
+        m_lod = makePooled<ChunkLod>(m_size);
+        m_lod->build(getVoxels());
+    }
+    return *m_lod;
+}
+
+const ChunkOccupancy &Chunk::getOccupancy() const
+{
+    return m_occupancy;
+}
+
+bool Chunk::isUnsaved() const
+{
+    return m_unsaved;
 }
 
-Lightmap &Chunk::getLightmap()
+void Chunk::serialize(std::vector<uint8_t> &data) const
 {
-    return m_light_map;
+    // Dormant data is the serialized chunk already
+    if (m_dormant.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock{m_dormant_mutex};
+        if (m_dormant.load(std::memory_order_relaxed)) {
+            data.insert(data.end(), m_dormant_data.begin(), m_dormant_data.end());
+            return;
+        }
+    }
+
+    BinaryWriter writer{data};
+    m_voxels->serialize(writer);
+    m_light_map->serialize(writer);
+}
+
+bool Chunk::deserialize(std::span<const uint8_t> data)
+{
+    BinaryReader reader{data.data(), data.size()};
+    const bool result = getMutableVoxels().deserialize(reader)
+                        && getMutableLightmap().deserialize(reader);
+    rebuildSummaries();
+    if (!result)
+        return false;
+
+    m_modified = true;
+    m_unsaved = false;
+    return true;
+}
+
+bool Chunk::isDormant() const
+{
+    return m_dormant.load(std::memory_order_acquire);
+}
+
+size_t Chunk::getDormantMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock{m_dormant_mutex};
+    return m_dormant.load(std::memory_order_relaxed) ? m_dormant_data.capacity() : 0;
+}
+
+bool Chunk::compress(std::vector<uint8_t> &buffer)
+{
+    if (m_dormant.load(std::memory_order_relaxed) || m_voxels->isUniform()
+        || m_voxels.use_count() > 1 || m_light_map.use_count() > 1)
+        return false;
+
+    const size_t raw_size = m_voxels->getMemoryUsage() + m_light_map->getMemoryUsage();
+    buffer.clear();
+    BinaryWriter writer{buffer};
+    m_voxels->serialize(writer);
+    m_light_map->serialize(writer);
+    if (buffer.size() >= raw_size)
+        return false;
+
+    std::lock_guard<std::mutex> lock{m_dormant_mutex};
+    m_dormant_data.assign(buffer.begin(), buffer.end());
+    m_dormant_raw_size = raw_size;
+    m_voxels.reset();
+    m_light_map.reset();
+    m_dormant.store(true, std::memory_order_release);
+    return true;
+}
+
+void Chunk::decompress() const
+{
+    std::lock_guard<std::mutex> lock{m_dormant_mutex};
+    if (!m_dormant.load(std::memory_order_relaxed))
+        return;
+
+    Clock clock;
+    auto voxels = makeSharedPooled<VoxelStorage>(m_size.x * m_size.y * m_size.z);
+    auto light_map = makeSharedPooled<Lightmap>(m_size);
+    BinaryReader reader{m_dormant_data.data(), m_dormant_data.size()};
+    // The data was written by compress(), a failure means memory corruption
+    if (!voxels->deserialize(reader) || !light_map->deserialize(reader))
+        spdlog::error("Failed to decompress dormant chunk {} {} {}",
+                      m_position.x,
+                      m_position.y,
+                      m_position.z);
+
+    m_voxels = std::move(voxels);
+    m_light_map = std::move(light_map);
+    m_dormant_data.clear();
+    m_dormant_data.shrink_to_fit();
+    m_dormant.store(false, std::memory_order_release);
+    touch(Clock::getCurrentTime());
+
+    m_chunks->onChunkDecompressed(clock.getElapsedTime());
+}
+
+void Chunk::touch(const Time &time) const
+{
+    m_touch_time.store(time.asMicroseconds(), std::memory_order_relaxed);
+}
+
+Time Chunk::getTouchTime() const
+{
+    return Time{m_touch_time.load(std::memory_order_relaxed)};
+}
+
+int32_t Chunk::fill(const Voxel &voxel)
+{
+    const int32_t changed_count = getMutableVoxels().fill(voxel);
+    if (changed_count > 0)
+        rebuildSummaries();
+    return changed_count;
+}
+
+VoxelStorage &Chunk::getMutableVoxels()
+{
+    wake();
+    // Only the owning thread copies the pointer, a count of one means no
+    // snapshot can still read the storage
+    if (m_voxels.use_count() > 1)
+        m_voxels = makeSharedPooled<VoxelStorage>(*m_voxels);
+    m_version = nextVersion();
+    m_voxels_version = m_version;
+    return *m_voxels;
+}
+
+void Chunk::updateSummaries(const glm::i32vec3 &voxel_coords,
+                            const Voxel &old_voxel,
+                            const Voxel &voxel)
+{
+    if (old_voxel.id == voxel.id)
+        return;
+
+    if (m_lod)
+        m_lod->update(voxel_coords, old_voxel, voxel);
+    m_occupancy.update(voxel_coords, old_voxel, voxel);
 }
 
-int32_t Chunk::voxelCoordsToIndex(const glm::i32vec3 &voxel_coords) const
+void Chunk::rebuildSummaries()
 {
-    auto &chunk_size = m_chunks->getChunkSize();
-    return (voxel_coords.y * chunk_size.z + voxel_coords.z) * chunk_size.x + voxel_coords.x;
+    const VoxelStorage &voxels = getVoxels();
+    if (m_lod)
+        m_lod->build(voxels);
+    m_occupancy.build(voxels);
 }
 
 } // namespace eb
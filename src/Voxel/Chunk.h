@@ -1,11 +1,24 @@
 #ifndef EB_VOXEL_CHUNK_H
 #define EB_VOXEL_CHUNK_H
 
+#include "../System/Time.h"
 #include "../VoxelLigtning/Lightmap.h"
+#include "ChunkLod.h"
+#include "ChunkOccupancy.h"
+#include "ChunkSnapshot.h"
 #include "Voxel.h"
+#include "VoxelStorage.h"
 
 #include <glm/glm.hpp>
 
+#include <assert.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace eb {
@@ -17,6 +30,7 @@ class Chunk
 {
     friend class Chunks;
     friend class LightSolver;
+    friend class RegionStorage;
 
 public:
     Chunk(const glm::i32vec3 &position, Chunks *chunks);
@@ -24,22 +38,149 @@ public:
 
     Chunks *getChunks() const;
     const glm::i32vec3 &getPosition() const;
+    const glm::i32vec3 &getSize() const;
+
+    // Loaded chunk at offset in [-1, 1] per axis or nullptr, offset zero is
+    // the chunk itself. Links are kept by Chunks on load and unload.
+    Chunk *getNeighbour(const glm::i32vec3 &offset) const;
+
+    // Copied out, the voxel storage may reuse or move its palette on writes
+    std::optional<Voxel> getVoxel(const glm::i32vec3 &voxel_coords) const;
+    // False when the voxel already had that id, nothing is changed then
+    bool setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel);
+
+    // Neither wakes a dormant chunk, dormant chunks are never uniform
+    bool isUniform() const;
+    Voxel getUniformVoxel() const;
 
-    const Voxel *getVoxel(const glm::i32vec3 &voxel_coords) const;
-    void setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel);
+    const VoxelStorage &getVoxels() const;
+    const Lightmap &getLightmap() const;
+    // Copies the light map first while snapshots share it
+    Lightmap &getMutableLightmap();
+    // Drops the light array of an unshared light map holding one value, the
+    // light values and the version stay the same
+    void collapseLightmap();
 
-    Lightmap &getLightmap();
+    // Unique across all chunks and changed by every write access to the chunk
+    // voxels or light map
+    uint64_t getVersion() const;
+    // Changed by write access to the voxels only
+    uint64_t getVoxelsVersion() const;
+    // Entry of this chunk for a ChunkSnapshot
+    ChunkSnapshot::Entry getSnapshotEntry() const;
+
+    bool hasLod() const;
+    // Built from the voxels on first use, kept up to date by edits afterwards
+    const ChunkLod &getLod() const;
+
+    // Kept up to date by edits, empty chunks and bricks hold only air. Opaque
+    // bits follow block registry changes on the next Chunks::update().
+    const ChunkOccupancy &getOccupancy() const;
 
     int32_t voxelCoordsToIndex(const glm::i32vec3 &voxel_coords) const;
 
+    bool isUnsaved() const;
+    void serialize(std::vector<uint8_t> &data) const;
+    bool deserialize(std::span<const uint8_t> data);
+
+    // Dormant chunks keep their voxels and light map serialized in memory and
+    // decompress them on the first access to either, from any thread. LOD and
+    // occupancy stay resident.
+    bool isDormant() const;
+    size_t getDormantMemoryUsage() const;
+
+private:
+    // Serializes the storage and releases it, false when the chunk can not go
+    // dormant: uniform voxels, storage shared with snapshots or no gain
+    bool compress(std::vector<uint8_t> &buffer);
+    void wake() const;
+    void decompress() const;
+    void touch(const Time &time) const;
+    Time getTouchTime() const;
+
+    // Copies the voxels first while snapshots share them, callers must keep
+    // the chunk summaries in sync
+    VoxelStorage &getMutableVoxels();
+
+    // Fills the whole chunk, returns the number of changed voxels
+    int32_t fill(const Voxel &voxel);
+
+    // Keeps the LOD pyramid and the occupancy in sync with voxel writes, voxels
+    // written straight into storage need a rebuild afterwards
+    void updateSummaries(const glm::i32vec3 &voxel_coords,
+                         const Voxel &old_voxel,
+                         const Voxel &voxel);
+    void rebuildSummaries();
+
+    static int32_t neighbourToIndex(const glm::i32vec3 &offset);
+
 private:
     Chunks *m_chunks;
     glm::i32vec3 m_position;
-    std::vector<Voxel> m_voxels;
-    Lightmap m_light_map;
+    glm::i32vec3 m_size;
+    // Released while dormant
+    mutable std::shared_ptr<VoxelStorage> m_voxels;
+    mutable std::shared_ptr<Lightmap> m_light_map;
+    uint64_t m_version;
+    uint64_t m_voxels_version;
+    mutable PoolPtr<ChunkLod> m_lod;
+    ChunkOccupancy m_occupancy;
+    std::array<Chunk *, 27> m_neighbours;
     bool m_modified;
+    bool m_unsaved;
+
+    mutable std::mutex m_dormant_mutex;
+    mutable std::atomic<bool> m_dormant;
+    mutable std::vector<uint8_t> m_dormant_data;
+    // Resident bytes the compressed data replaced
+    size_t m_dormant_raw_size;
+    mutable std::atomic<int64_t> m_touch_time;
 };
 
+inline Chunk *Chunk::getNeighbour(const glm::i32vec3 &offset) const
+{
+    return m_neighbours[neighbourToIndex(offset)];
+}
+
+inline int32_t Chunk::neighbourToIndex(const glm::i32vec3 &offset)
+{
+    assert(offset.x >= -1 && offset.x <= 1 && offset.y >= -1 && offset.y <= 1);
+    assert(offset.z >= -1 && offset.z <= 1);
+    return ((offset.y + 1) * 3 + offset.z + 1) * 3 + offset.x + 1;
+}
+
+inline const VoxelStorage &Chunk::getVoxels() const
+{
+    wake();
+    return *m_voxels;
+}
+
+inline const Lightmap &Chunk::getLightmap() const
+{
+    wake();
+    return *m_light_map;
+}
+
+inline void Chunk::wake() const
+{
+    if (m_dormant.load(std::memory_order_acquire))
+        decompress();
+}
+
+inline std::optional<Voxel> Chunk::getVoxel(const glm::i32vec3 &voxel_coords) const
+{
+    wake();
+    int32_t index = voxelCoordsToIndex(voxel_coords);
+    if (index < 0 || index >= m_voxels->getSize())
+        return std::nullopt;
+    return m_voxels->get(index);
+}
+
+inline int32_t Chunk::voxelCoordsToIndex(const glm::i32vec3 &voxel_coords) const
+{
+    return (voxel_coords.y * m_size.z + voxel_coords.z) * m_size.x + voxel_coords.x;
+}
+
 } // namespace eb
 
 #endif // EB_VOXEL_CHUNK_H
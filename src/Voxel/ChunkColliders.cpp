@@ -0,0 +1,189 @@
+#include "ChunkColliders.h"
+#include "Chunks.h"
+
+#include <reactphysics3d/reactphysics3d.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace eb {
+
+ChunkColliders::ChunkColliders(Chunks *chunks,
+                               reactphysics3d::PhysicsCommon *physics_common,
+                               reactphysics3d::PhysicsWorld *physics_world)
+    : m_chunks{chunks}
+    , m_physics_common{physics_common}
+    , m_physics_world{physics_world}
+    , m_boxes_count{0}
+{}
+
+ChunkColliders::~ChunkColliders()
+{
+    m_bodies.forEach([this](const glm::i32vec3 &, Body &body) {
+        m_physics_world->destroyRigidBody(body.body);
+    });
+    m_box_shapes.forEach([this](const glm::i32vec3 &, reactphysics3d::BoxShape *&box_shape) {
+        m_physics_common->destroyBoxShape(box_shape);
+    });
+}
+
+int32_t ChunkColliders::getBodiesCount() const
+{
+    return m_bodies.getSize();
+}
+
+int32_t ChunkColliders::getBoxesCount() const
+{
+    return m_boxes_count;
+}
+
+int32_t ChunkColliders::getShapesCount() const
+{
+    return m_box_shapes.getSize();
+}
+
+void ChunkColliders::update(const Chunk *chunk)
+{
+    // The boxes follow the solid bits, which may lag a block registry change
+    // until the occupancy is rebuilt
+    const uint32_t block_registry_version = chunk->getOccupancy().getBlockRegistryVersion();
+    Body *body = m_bodies.find(chunk->getPosition());
+    if (body && body->voxels_version == chunk->getVoxelsVersion()
+        && body->block_registry_version == block_registry_version)
+        return;
+
+    if (!body) {
+        const glm::vec3 origin = glm::vec3{chunk->getPosition() * chunk->getSize()}
+                                 * m_chunks->getVoxelSize();
+        const reactphysics3d::Transform transform{{origin.x, origin.y, origin.z},
+                                                  reactphysics3d::Quaternion::identity()};
+        body = &m_bodies.insert(chunk->getPosition(), Body{});
+        body->body = m_physics_world->createRigidBody(transform);
+        body->body->setType(reactphysics3d::BodyType::STATIC);
+    }
+
+    while (body->body->getNbColliders() > 0)
+        body->body->removeCollider(body->body->getCollider(0));
+    m_boxes_count -= body->boxes_count;
+
+    buildBoxes(chunk->getOccupancy(), m_boxes);
+
+    const float voxel_size = m_chunks->getVoxelSize();
+    for (const Box &box : m_boxes) {
+        const glm::vec3 center = (glm::vec3{box.min} + glm::vec3{box.size} * 0.5f) * voxel_size;
+        body->body->addCollider(getBoxShape(box.size),
+                                reactphysics3d::Transform{{center.x, center.y, center.z},
+                                                          reactphysics3d::Quaternion::identity()});
+    }
+
+    body->voxels_version = chunk->getVoxelsVersion();
+    body->block_registry_version = block_registry_version;
+    body->boxes_count = m_boxes.size();
+    m_boxes_count += body->boxes_count;
+}
+
+void ChunkColliders::remove(const glm::i32vec3 &chunk_coords)
+{
+    Body *body = m_bodies.find(chunk_coords);
+    if (!body)
+        return;
+
+    m_physics_world->destroyRigidBody(body->body);
+    m_boxes_count -= body->boxes_count;
+    m_bodies.remove(chunk_coords);
+}
+
+void ChunkColliders::buildBoxes(const ChunkOccupancy &occupancy, std::vector<Box> &boxes)
+{
+    const glm::i32vec3 &size = m_chunks->getChunkSize();
+    const int32_t row_words_count = occupancy.getRowWordsCount();
+
+    boxes.clear();
+    if (occupancy.isEmpty())
+        return;
+
+    // Solid voxels not taken by a box yet, a copy of the occupancy solid rows
+    const PoolVector<uint64_t> &solid_mask = occupancy.getSolidMask();
+    m_solid.assign(solid_mask.begin(), solid_mask.end());
+
+    const auto row = [this, &size, row_words_count](int32_t y, int32_t z) {
+        return m_solid.data() + (y * size.z + z) * row_words_count;
+    };
+    const auto isSet = [](const uint64_t *words, int32_t x) {
+        return (words[x >> 6] >> (x & 63)) & 1;
+    };
+    // Mask of the bits of [min_x, max_x) in the word of min_x, with the end
+    // of the range or of the word
+    const auto wordRange = [](int32_t min_x, int32_t max_x, int32_t &end_x) {
+        end_x = std::min(max_x, (min_x | 63) + 1);
+        return (~uint64_t{0} >> (64 - (end_x - min_x))) << (min_x & 63);
+    };
+    const auto isRowSolid = [&row, &wordRange](int32_t y, int32_t z, int32_t min_x,
+                                               int32_t max_x) {
+        const uint64_t *words = row(y, z);
+        for (int32_t x = min_x, end_x; x < max_x; x = end_x) {
+            const uint64_t mask = wordRange(x, max_x, end_x);
+            if ((words[x >> 6] & mask) != mask)
+                return false;
+        }
+        return true;
+    };
+
+    for (int32_t y = 0; y < size.y; ++y) {
+        for (int32_t z = 0; z < size.z; ++z) {
+            for (int32_t x = 0; x < size.x; ++x) {
+                // Skips the clear bits of the word in one step
+                const uint64_t rest = row(y, z)[x >> 6] >> (x & 63);
+                if (rest == 0) {
+                    x |= 63;
+                    continue;
+                }
+                if (!(rest & 1)) {
+                    x += std::countr_zero(rest) - 1;
+                    continue;
+                }
+
+                int32_t max_x = x + 1;
+                while (max_x < size.x && isSet(row(y, z), max_x))
+                    ++max_x;
+
+                int32_t max_z = z + 1;
+                while (max_z < size.z && isRowSolid(y, max_z, x, max_x))
+                    ++max_z;
+
+                int32_t max_y = y + 1;
+                for (; max_y < size.y; ++max_y) {
+                    bool solid = true;
+                    for (int32_t box_z = z; box_z < max_z && solid; ++box_z)
+                        solid = isRowSolid(max_y, box_z, x, max_x);
+                    if (!solid)
+                        break;
+                }
+
+                for (int32_t box_y = y; box_y < max_y; ++box_y) {
+                    for (int32_t box_z = z; box_z < max_z; ++box_z) {
+                        uint64_t *words = row(box_y, box_z);
+                        for (int32_t box_x = x, end_x; box_x < max_x; box_x = end_x)
+                            words[box_x >> 6] &= ~wordRange(box_x, max_x, end_x);
+                    }
+                }
+
+                boxes.push_back({{x, y, z}, {max_x - x, max_y - y, max_z - z}});
+                x = max_x - 1;
+            }
+        }
+    }
+}
+
+reactphysics3d::BoxShape *ChunkColliders::getBoxShape(const glm::i32vec3 &size)
+{
+    if (auto *box_shape = m_box_shapes.find(size))
+        return *box_shape;
+
+    const glm::vec3 half_extents = glm::vec3{size} * (m_chunks->getVoxelSize() * 0.5f);
+    return m_box_shapes.insert(size,
+                               m_physics_common->createBoxShape(
+                                   {half_extents.x, half_extents.y, half_extents.z}));
+}
+
+} // namespace eb
@@ -0,0 +1,82 @@
+#ifndef EB_VOXEL_CHUNKCOLLIDERS_H
+#define EB_VOXEL_CHUNKCOLLIDERS_H
+
+#include "ChunkMap.h"
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+namespace reactphysics3d {
+class BoxShape;
+class PhysicsCommon;
+class PhysicsWorld;
+class RigidBody;
+} // namespace reactphysics3d
+
+namespace eb {
+
+class Chunk;
+class ChunkOccupancy;
+class Chunks;
+
+// Collision for chunk terrain: solid voxels of a chunk are merged into axis
+// aligned boxes attached to one static rigid body per chunk. Box shapes are
+// shared between all boxes of the same size.
+class ChunkColliders
+{
+public:
+    // Local voxel coords of the box corner and box size in voxels
+    struct Box
+    {
+        glm::i32vec3 min{0};
+        glm::i32vec3 size{0};
+    };
+
+    ChunkColliders(Chunks *chunks,
+                   reactphysics3d::PhysicsCommon *physics_common,
+                   reactphysics3d::PhysicsWorld *physics_world);
+    // Destroys the bodies and shapes, the physics world must still exist
+    ~ChunkColliders();
+
+    int32_t getBodiesCount() const;
+    int32_t getBoxesCount() const;
+    int32_t getShapesCount() const;
+
+    // Rebuilds the chunk body when its voxels or the block properties changed
+    // since the last build
+    void update(const Chunk *chunk);
+    void remove(const glm::i32vec3 &chunk_coords);
+
+    // Greedy merge of the occupancy solid bits: a box grows along x, then z,
+    // then y over voxels not taken by earlier boxes
+    void buildBoxes(const ChunkOccupancy &occupancy, std::vector<Box> &boxes);
+
+private:
+    struct Body
+    {
+        reactphysics3d::RigidBody *body = nullptr;
+        uint64_t voxels_version = 0;
+        uint32_t block_registry_version = 0;
+        int32_t boxes_count = 0;
+    };
+
+    reactphysics3d::BoxShape *getBoxShape(const glm::i32vec3 &size);
+
+private:
+    Chunks *m_chunks;
+    reactphysics3d::PhysicsCommon *m_physics_common;
+    reactphysics3d::PhysicsWorld *m_physics_world;
+    ChunkMap<Body> m_bodies;
+    ChunkMap<reactphysics3d::BoxShape *> m_box_shapes;
+    int32_t m_boxes_count;
+
+    // Scratch buffers reused between builds
+    std::vector<uint64_t> m_solid;
+    std::vector<Box> m_boxes;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_CHUNKCOLLIDERS_H
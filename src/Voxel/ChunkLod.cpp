@@ -0,0 +1,144 @@
+#include "ChunkLod.h"
+#include "VoxelStorage.h"
+
+#include <algorithm>
+
+namespace eb {
+
+static const Voxel AIR{0};
+
+ChunkLod::ChunkLod(const glm::i32vec3 &chunk_size)
+    : m_chunk_size{chunk_size}
+{
+    glm::i32vec3 size = chunk_size;
+    while (size.x > 1 || size.y > 1 || size.z > 1) {
+        size = (size + 1) >> 1;
+
+        Level level;
+        level.size = size;
+        level.occupied_counts.assign(size.x * size.y * size.z, 0);
+        level.materials.assign(level.occupied_counts.size(), AIR);
+        m_levels.push_back(std::move(level));
+    }
+}
+
+int32_t ChunkLod::getLevelsCount() const
+{
+    return m_levels.size();
+}
+
+glm::i32vec3 ChunkLod::getLevelSize(int32_t level) const
+{
+    return level == 0 ? m_chunk_size : m_levels[level - 1].size;
+}
+
+uint32_t ChunkLod::getOccupiedCount(int32_t level, const glm::i32vec3 &cell_coords) const
+{
+    const Level &lod_level = m_levels[level - 1];
+    return lod_level.occupied_counts[cellToIndex(lod_level, cell_coords)];
+}
+
+uint32_t ChunkLod::getVolume(int32_t level, const glm::i32vec3 &cell_coords) const
+{
+    const glm::i32vec3 min_voxel = cell_coords << level;
+    const glm::i32vec3 max_voxel = glm::min((cell_coords + 1) << level, m_chunk_size);
+    const glm::i32vec3 size = max_voxel - min_voxel;
+    return size.x * size.y * size.z;
+}
+
+const Voxel &ChunkLod::getMaterial(int32_t level, const glm::i32vec3 &cell_coords) const
+{
+    const Level &lod_level = m_levels[level - 1];
+    return lod_level.materials[cellToIndex(lod_level, cell_coords)];
+}
+
+void ChunkLod::build(const VoxelStorage &voxels)
+{
+    if (m_levels.empty())
+        return;
+
+    for (auto &level : m_levels) {
+        std::fill(level.occupied_counts.begin(), level.occupied_counts.end(), 0);
+        std::fill(level.materials.begin(), level.materials.end(), AIR);
+    }
+
+    // First level from the voxels, in storage order
+    Level &first_level = m_levels.front();
+    glm::i32vec3 voxel_coords{0};
+    voxels.forEach([this, &first_level, &voxel_coords](int32_t, const Voxel &voxel) {
+        if (voxel.id != 0) {
+            const int32_t index = cellToIndex(first_level, voxel_coords >> 1);
+            if (first_level.occupied_counts[index]++ == 0)
+                first_level.materials[index] = voxel;
+        }
+
+        if (++voxel_coords.x == m_chunk_size.x) {
+            voxel_coords.x = 0;
+            if (++voxel_coords.z == m_chunk_size.z) {
+                voxel_coords.z = 0;
+                ++voxel_coords.y;
+            }
+        }
+    });
+
+    // Every next level sums its children
+    for (size_t i = 1; i < m_levels.size(); ++i) {
+        const Level &children = m_levels[i - 1];
+        Level &level = m_levels[i];
+
+        glm::i32vec3 child;
+        for (child.y = 0; child.y < children.size.y; ++child.y) {
+            for (child.z = 0; child.z < children.size.z; ++child.z) {
+                for (child.x = 0; child.x < children.size.x; ++child.x) {
+                    const int32_t child_index = cellToIndex(children, child);
+                    if (children.occupied_counts[child_index] == 0)
+                        continue;
+
+                    const int32_t index = cellToIndex(level, child >> 1);
+                    if (level.occupied_counts[index] == 0)
+                        level.materials[index] = children.materials[child_index];
+                    level.occupied_counts[index] += children.occupied_counts[child_index];
+                }
+            }
+        }
+    }
+}
+
+void ChunkLod::update(const glm::i32vec3 &voxel_coords, const Voxel &old_voxel, const Voxel &voxel)
+{
+    const bool was_occupied = old_voxel.id != 0;
+    const bool is_occupied = voxel.id != 0;
+
+    for (size_t i = 0; i < m_levels.size(); ++i) {
+        Level &level = m_levels[i];
+        const int32_t index = cellToIndex(level, voxel_coords >> static_cast<int32_t>(i + 1));
+        uint32_t &occupied_count = level.occupied_counts[index];
+        Voxel &material = level.materials[index];
+
+        if (was_occupied && !is_occupied) {
+            if (--occupied_count == 0)
+                material = AIR;
+        } else if (!was_occupied && is_occupied) {
+            if (occupied_count++ == 0)
+                material = voxel;
+        } else if (is_occupied && material.id == old_voxel.id) {
+            material = voxel;
+        }
+    }
+}
+
+size_t ChunkLod::getMemoryUsage() const
+{
+    size_t memory = sizeof(ChunkLod) + m_levels.capacity() * sizeof(Level);
+    for (const auto &level : m_levels)
+        memory += level.occupied_counts.capacity() * sizeof(uint32_t)
+                  + level.materials.capacity() * sizeof(Voxel);
+    return memory;
+}
+
+int32_t ChunkLod::cellToIndex(const Level &level, const glm::i32vec3 &cell_coords) const
+{
+    return (cell_coords.y * level.size.z + cell_coords.z) * level.size.x + cell_coords.x;
+}
+
+} // namespace eb
@@ -0,0 +1,59 @@
+#ifndef EB_VOXEL_CHUNKLOD_H
+#define EB_VOXEL_CHUNKLOD_H
+
+#include "../System/MemoryPool.h"
+#include "Voxel.h"
+
+#include <glm/glm.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace eb {
+
+class VoxelStorage;
+
+// Mip pyramid over the voxels of one chunk. A level l cell covers 2^l voxels
+// per axis and keeps the number of occupied voxels inside it, any id but air
+// regardless of block properties, and a representative material. Level 0 is
+// the chunk itself and is not stored, the last level is a single cell for the
+// whole chunk.
+class ChunkLod
+{
+public:
+    ChunkLod(const glm::i32vec3 &chunk_size);
+    ~ChunkLod() = default;
+
+    int32_t getLevelsCount() const;
+    glm::i32vec3 getLevelSize(int32_t level) const;
+
+    uint32_t getOccupiedCount(int32_t level, const glm::i32vec3 &cell_coords) const;
+    // Number of chunk voxels covered by the cell, smaller on clipped edge cells
+    uint32_t getVolume(int32_t level, const glm::i32vec3 &cell_coords) const;
+    // Some occupied voxel of the cell, air when the cell is empty
+    const Voxel &getMaterial(int32_t level, const glm::i32vec3 &cell_coords) const;
+
+    void build(const VoxelStorage &voxels);
+    void update(const glm::i32vec3 &voxel_coords, const Voxel &old_voxel, const Voxel &voxel);
+
+    size_t getMemoryUsage() const;
+
+private:
+    struct Level
+    {
+        glm::i32vec3 size;
+        PoolVector<uint32_t> occupied_counts;
+        PoolVector<Voxel> materials;
+    };
+
+    int32_t cellToIndex(const Level &level, const glm::i32vec3 &cell_coords) const;
+
+private:
+    glm::i32vec3 m_chunk_size;
+    std::vector<Level> m_levels;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_CHUNKLOD_H
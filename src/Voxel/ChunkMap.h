@@ -0,0 +1,161 @@
+#ifndef EB_VOXEL_CHUNKMAP_H
+#define EB_VOXEL_CHUNKMAP_H
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+namespace eb {
+
+// Open addressing hash map keyed by chunk coords, linear probing with
+// backward shift deletion
+template<typename T>
+class ChunkMap
+{
+public:
+    ChunkMap() { m_slots.resize(MIN_CAPACITY); }
+    ~ChunkMap() = default;
+
+    int32_t getSize() const { return m_size; }
+    int32_t getCapacity() const { return m_slots.size(); }
+
+    T *find(const glm::i32vec3 &coords)
+    {
+        int32_t index = findSlot(coords);
+        return index < 0 ? nullptr : &m_slots[index].value;
+    }
+
+    const T *find(const glm::i32vec3 &coords) const
+    {
+        int32_t index = findSlot(coords);
+        return index < 0 ? nullptr : &m_slots[index].value;
+    }
+
+    bool contains(const glm::i32vec3 &coords) const { return findSlot(coords) >= 0; }
+
+    T &insert(const glm::i32vec3 &coords, T &&value)
+    {
+        if ((m_size + 1) * 4 > getCapacity() * 3)
+            rehash(getCapacity() * 2);
+
+        uint32_t mask = getCapacity() - 1;
+        for (uint32_t index = hash(coords) & mask;; index = (index + 1) & mask) {
+            Slot &slot = m_slots[index];
+            if (!slot.used) {
+                slot.coords = coords;
+                slot.used = true;
+                slot.value = std::move(value);
+                ++m_size;
+                return slot.value;
+            }
+            if (slot.coords == coords) {
+                slot.value = std::move(value);
+                return slot.value;
+            }
+        }
+    }
+
+    bool remove(const glm::i32vec3 &coords)
+    {
+        int32_t index = findSlot(coords);
+        if (index < 0)
+            return false;
+
+        uint32_t mask = getCapacity() - 1;
+        uint32_t hole = index;
+        m_slots[hole] = Slot{};
+
+        for (uint32_t next = (hole + 1) & mask; m_slots[next].used; next = (next + 1) & mask) {
+            uint32_t home = hash(m_slots[next].coords) & mask;
+            // Shift back entries whose probe sequence passes through the hole
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                m_slots[hole] = std::move(m_slots[next]);
+                m_slots[next] = Slot{};
+                hole = next;
+            }
+        }
+
+        --m_size;
+        return true;
+    }
+
+    void clear()
+    {
+        m_slots.clear();
+        m_slots.resize(MIN_CAPACITY);
+        m_size = 0;
+    }
+
+    template<typename F>
+    void forEach(F &&func)
+    {
+        for (auto &slot : m_slots) {
+            if (slot.used)
+                func(slot.coords, slot.value);
+        }
+    }
+
+    template<typename F>
+    void forEach(F &&func) const
+    {
+        for (const auto &slot : m_slots) {
+            if (slot.used)
+                func(slot.coords, slot.value);
+        }
+    }
+
+    static uint32_t hash(const glm::i32vec3 &coords)
+    {
+        uint32_t h = static_cast<uint32_t>(coords.x) * 0x8da6b343u
+                     ^ static_cast<uint32_t>(coords.y) * 0xd8163841u
+                     ^ static_cast<uint32_t>(coords.z) * 0xcb1ab31fu;
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        return h;
+    }
+
+private:
+    static constexpr int32_t MIN_CAPACITY = 16;
+
+    struct Slot
+    {
+        glm::i32vec3 coords{0};
+        bool used = false;
+        T value{};
+    };
+
+    int32_t findSlot(const glm::i32vec3 &coords) const
+    {
+        uint32_t mask = getCapacity() - 1;
+        for (uint32_t index = hash(coords) & mask;; index = (index + 1) & mask) {
+            const Slot &slot = m_slots[index];
+            if (!slot.used)
+                return -1;
+            if (slot.coords == coords)
+                return index;
+        }
+    }
+
+    void rehash(int32_t capacity)
+    {
+        std::vector<Slot> slots(capacity);
+        std::swap(m_slots, slots);
+        m_size = 0;
+
+        for (auto &slot : slots) {
+            if (slot.used)
+                insert(slot.coords, std::move(slot.value));
+        }
+    }
+
+private:
+    std::vector<Slot> m_slots;
+    int32_t m_size = 0;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_CHUNKMAP_H
@@ -0,0 +1,200 @@
+#include "ChunkOccupancy.h"
+#include "BlockRegistry.h"
+#include "VoxelStorage.h"
+
+#include <algorithm>
+
+namespace eb {
+
+ChunkOccupancy::ChunkOccupancy(const glm::i32vec3 &chunk_size,
+                               const BlockRegistry &block_registry)
+    : m_block_registry{&block_registry}
+    , m_block_registry_version{block_registry.getVersion()}
+    , m_chunk_size{chunk_size}
+    , m_bricks_size{(chunk_size + BRICK_SIZE - 1) >> BRICK_SHIFT}
+    , m_occupied_count{0}
+    , m_brick_counts(m_bricks_size.x * m_bricks_size.y * m_bricks_size.z, 0)
+    , m_brick_mask((m_brick_counts.size() + 63) / 64, 0)
+    , m_row_words_count{(chunk_size.x + 63) / 64}
+    , m_opaque_mask(chunk_size.y * chunk_size.z * m_row_words_count, 0)
+    , m_solid_mask(m_opaque_mask.size(), 0)
+    , m_column_heights(chunk_size.x * chunk_size.z, 0)
+{}
+
+int32_t ChunkOccupancy::getOccupiedCount() const
+{
+    return m_occupied_count;
+}
+
+const glm::i32vec3 &ChunkOccupancy::getBricksSize() const
+{
+    return m_bricks_size;
+}
+
+const PoolVector<uint64_t> &ChunkOccupancy::getBrickMask() const
+{
+    return m_brick_mask;
+}
+
+int32_t ChunkOccupancy::getRowWordsCount() const
+{
+    return m_row_words_count;
+}
+
+const PoolVector<uint64_t> &ChunkOccupancy::getOpaqueMask() const
+{
+    return m_opaque_mask;
+}
+
+const PoolVector<uint64_t> &ChunkOccupancy::getSolidMask() const
+{
+    return m_solid_mask;
+}
+
+uint32_t ChunkOccupancy::getBlockRegistryVersion() const
+{
+    return m_block_registry_version;
+}
+
+void ChunkOccupancy::build(const VoxelStorage &voxels)
+{
+    std::fill(m_brick_counts.begin(), m_brick_counts.end(), 0);
+    std::fill(m_brick_mask.begin(), m_brick_mask.end(), 0);
+    std::fill(m_opaque_mask.begin(), m_opaque_mask.end(), 0);
+    std::fill(m_solid_mask.begin(), m_solid_mask.end(), 0);
+    std::fill(m_column_heights.begin(), m_column_heights.end(), 0);
+    m_occupied_count = 0;
+    m_block_registry_version = m_block_registry->getVersion();
+
+    if (voxels.isUniform()) {
+        const int32_t id = voxels.get(0).id;
+        // Bits past the row end stay clear
+        const auto fillMask = [this](PoolVector<uint64_t> &mask) {
+            for (int32_t x = 0; x < m_chunk_size.x; ++x)
+                mask[x >> 6] |= uint64_t{1} << (x & 63);
+            for (size_t row = 1; row < mask.size() / m_row_words_count; ++row)
+                std::copy(mask.begin(),
+                          mask.begin() + m_row_words_count,
+                          mask.begin() + row * m_row_words_count);
+        };
+        if (m_block_registry->isOpaque(id)) {
+            fillMask(m_opaque_mask);
+            std::fill(m_column_heights.begin(), m_column_heights.end(), m_chunk_size.y);
+        }
+        if (m_block_registry->isSolid(id))
+            fillMask(m_solid_mask);
+
+        if (id == 0)
+            return;
+
+        // Full bricks hold BRICK_SIZE^3 voxels, edge bricks are clipped
+        glm::i32vec3 brick;
+        for (brick.y = 0; brick.y < m_bricks_size.y; ++brick.y) {
+            for (brick.z = 0; brick.z < m_bricks_size.z; ++brick.z) {
+                for (brick.x = 0; brick.x < m_bricks_size.x; ++brick.x) {
+                    const glm::i32vec3 size = glm::min((brick + 1) << BRICK_SHIFT, m_chunk_size)
+                                              - (brick << BRICK_SHIFT);
+                    const int32_t index = brickToIndex(brick);
+                    m_brick_counts[index] = size.x * size.y * size.z;
+                    m_brick_mask[index >> 6] |= uint64_t{1} << (index & 63);
+                }
+            }
+        }
+        m_occupied_count = m_chunk_size.x * m_chunk_size.y * m_chunk_size.z;
+        return;
+    }
+
+    glm::i32vec3 voxel_coords{0};
+    size_t row = 0;
+    voxels.forEach([this, &voxel_coords, &row](int32_t, const Voxel &voxel) {
+        const uint64_t bit = uint64_t{1} << (voxel_coords.x & 63);
+        const size_t word = row + (voxel_coords.x >> 6);
+
+        // Rows go bottom up, the last opaque voxel of a column is its top
+        if (m_block_registry->isOpaque(voxel.id)) {
+            m_opaque_mask[word] |= bit;
+            const int32_t column = voxel_coords.z * m_chunk_size.x + voxel_coords.x;
+            m_column_heights[column] = voxel_coords.y + 1;
+        }
+        if (m_block_registry->isSolid(voxel.id))
+            m_solid_mask[word] |= bit;
+
+        if (voxel.id != 0) {
+            const int32_t index = brickToIndex(voxel_coords >> BRICK_SHIFT);
+            if (m_brick_counts[index]++ == 0)
+                m_brick_mask[index >> 6] |= uint64_t{1} << (index & 63);
+            ++m_occupied_count;
+        }
+
+        if (++voxel_coords.x == m_chunk_size.x) {
+            voxel_coords.x = 0;
+            row += m_row_words_count;
+            if (++voxel_coords.z == m_chunk_size.z) {
+                voxel_coords.z = 0;
+                ++voxel_coords.y;
+            }
+        }
+    });
+}
+
+void ChunkOccupancy::update(const glm::i32vec3 &voxel_coords,
+                            const Voxel &old_voxel,
+                            const Voxel &voxel)
+{
+    const size_t word = (voxel_coords.y * m_chunk_size.z + voxel_coords.z) * m_row_words_count
+                        + (voxel_coords.x >> 6);
+    const uint64_t voxel_bit = uint64_t{1} << (voxel_coords.x & 63);
+
+    const bool is_solid = m_block_registry->isSolid(voxel.id);
+    if (m_block_registry->isSolid(old_voxel.id) != is_solid)
+        m_solid_mask[word] ^= voxel_bit;
+
+    const bool is_opaque = m_block_registry->isOpaque(voxel.id);
+    if (m_block_registry->isOpaque(old_voxel.id) != is_opaque) {
+        m_opaque_mask[word] ^= voxel_bit;
+
+        uint16_t &height = m_column_heights[voxel_coords.z * m_chunk_size.x + voxel_coords.x];
+        if (is_opaque)
+            height = std::max<int32_t>(height, voxel_coords.y + 1);
+        else if (voxel_coords.y + 1 == height)
+            height = findColumnHeight(voxel_coords.x, voxel_coords.z, voxel_coords.y);
+    }
+
+    const bool was_occupied = old_voxel.id != 0;
+    const bool is_occupied = voxel.id != 0;
+    if (was_occupied == is_occupied)
+        return;
+
+    const int32_t index = brickToIndex(voxel_coords >> BRICK_SHIFT);
+    const uint64_t bit = uint64_t{1} << (index & 63);
+
+    if (is_occupied) {
+        ++m_occupied_count;
+        if (m_brick_counts[index]++ == 0)
+            m_brick_mask[index >> 6] |= bit;
+    } else {
+        --m_occupied_count;
+        if (--m_brick_counts[index] == 0)
+            m_brick_mask[index >> 6] &= ~bit;
+    }
+}
+
+size_t ChunkOccupancy::getMemoryUsage() const
+{
+    return sizeof(ChunkOccupancy) + m_brick_counts.capacity() * sizeof(uint8_t)
+           + m_brick_mask.capacity() * sizeof(uint64_t)
+           + m_opaque_mask.capacity() * sizeof(uint64_t)
+           + m_solid_mask.capacity() * sizeof(uint64_t)
+           + m_column_heights.capacity() * sizeof(uint16_t);
+}
+
+int32_t ChunkOccupancy::findColumnHeight(int32_t x, int32_t z, int32_t max_y) const
+{
+    for (int32_t y = max_y - 1; y >= 0; --y) {
+        if (isOpaque({x, y, z}))
+            return y + 1;
+    }
+    return 0;
+}
+
+} // namespace eb
@@ -0,0 +1,137 @@
+#ifndef EB_VOXEL_CHUNKOCCUPANCY_H
+#define EB_VOXEL_CHUNKOCCUPANCY_H
+
+#include "../System/MemoryPool.h"
+#include "Voxel.h"
+
+#include <glm/glm.hpp>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace eb {
+
+class BlockRegistry;
+class VoxelStorage;
+
+// Occupancy summary of one chunk, a voxel is occupied when it is not air.
+// The chunk is split into bricks of BRICK_SIZE voxels per axis, clipped on
+// the chunk edges, and every brick keeps its occupied voxels count and one
+// bit of the brick mask.
+// Opaque voxels are also kept one bit per voxel, in rows of 64 bit words
+// along x ordered like the voxel storage, for word parallel neighbour tests,
+// and as the height of the highest opaque voxel of every column. Solid voxels
+// get a mask with the same layout for colliders and ray casts.
+class ChunkOccupancy
+{
+public:
+    static constexpr int32_t BRICK_SHIFT = 2;
+    static constexpr int32_t BRICK_SIZE = 1 << BRICK_SHIFT;
+
+    ChunkOccupancy(const glm::i32vec3 &chunk_size, const BlockRegistry &block_registry);
+    ~ChunkOccupancy() = default;
+
+    bool isEmpty() const;
+    int32_t getOccupiedCount() const;
+
+    const glm::i32vec3 &getBricksSize() const;
+    bool isBrickEmpty(const glm::i32vec3 &brick_coords) const;
+    // Bit per brick in brick index order, set for bricks with occupied voxels
+    const PoolVector<uint64_t> &getBrickMask() const;
+
+    // Words per row of x voxels, bit x % 64 of word x / 64 is voxel x
+    int32_t getRowWordsCount() const;
+    const uint64_t *getOpaqueRow(int32_t y, int32_t z) const;
+    const PoolVector<uint64_t> &getOpaqueMask() const;
+    bool isOpaque(const glm::i32vec3 &voxel_coords) const;
+    const uint64_t *getSolidRow(int32_t y, int32_t z) const;
+    const PoolVector<uint64_t> &getSolidMask() const;
+    bool isSolid(const glm::i32vec3 &voxel_coords) const;
+    // Local y just above the highest opaque voxel of the column, zero when
+    // the column has none. Edits only rescan the column when its top opaque
+    // voxel is removed.
+    int32_t getColumnHeight(int32_t x, int32_t z) const;
+    // Block registry version the opaque and solid bits were built with
+    uint32_t getBlockRegistryVersion() const;
+
+    void build(const VoxelStorage &voxels);
+    void update(const glm::i32vec3 &voxel_coords, const Voxel &old_voxel, const Voxel &voxel);
+
+    size_t getMemoryUsage() const;
+
+private:
+    int32_t brickToIndex(const glm::i32vec3 &brick_coords) const;
+    int32_t findColumnHeight(int32_t x, int32_t z, int32_t max_y) const;
+
+private:
+    const BlockRegistry *m_block_registry;
+    uint32_t m_block_registry_version;
+    glm::i32vec3 m_chunk_size;
+    glm::i32vec3 m_bricks_size;
+    int32_t m_occupied_count;
+    PoolVector<uint8_t> m_brick_counts;
+    PoolVector<uint64_t> m_brick_mask;
+    int32_t m_row_words_count;
+    PoolVector<uint64_t> m_opaque_mask;
+    PoolVector<uint64_t> m_solid_mask;
+    PoolVector<uint16_t> m_column_heights;
+};
+
+inline bool ChunkOccupancy::isEmpty() const
+{
+    return m_occupied_count == 0;
+}
+
+inline bool ChunkOccupancy::isBrickEmpty(const glm::i32vec3 &brick_coords) const
+{
+    const int32_t index = brickToIndex(brick_coords);
+    return (m_brick_mask[index >> 6] & (uint64_t{1} << (index & 63))) == 0;
+}
+
+inline const uint64_t *ChunkOccupancy::getOpaqueRow(int32_t y, int32_t z) const
+{
+    assert(y >= 0 && y < m_chunk_size.y && z >= 0 && z < m_chunk_size.z);
+    return m_opaque_mask.data() + (y * m_chunk_size.z + z) * m_row_words_count;
+}
+
+inline bool ChunkOccupancy::isOpaque(const glm::i32vec3 &voxel_coords) const
+{
+    assert(voxel_coords.x >= 0 && voxel_coords.x < m_chunk_size.x);
+    return (getOpaqueRow(voxel_coords.y, voxel_coords.z)[voxel_coords.x >> 6]
+            >> (voxel_coords.x & 63))
+           & 1;
+}
+
+inline const uint64_t *ChunkOccupancy::getSolidRow(int32_t y, int32_t z) const
+{
+    assert(y >= 0 && y < m_chunk_size.y && z >= 0 && z < m_chunk_size.z);
+    return m_solid_mask.data() + (y * m_chunk_size.z + z) * m_row_words_count;
+}
+
+inline bool ChunkOccupancy::isSolid(const glm::i32vec3 &voxel_coords) const
+{
+    assert(voxel_coords.x >= 0 && voxel_coords.x < m_chunk_size.x);
+    return (getSolidRow(voxel_coords.y, voxel_coords.z)[voxel_coords.x >> 6]
+            >> (voxel_coords.x & 63))
+           & 1;
+}
+
+inline int32_t ChunkOccupancy::getColumnHeight(int32_t x, int32_t z) const
+{
+    assert(x >= 0 && x < m_chunk_size.x && z >= 0 && z < m_chunk_size.z);
+    return m_column_heights[z * m_chunk_size.x + x];
+}
+
+inline int32_t ChunkOccupancy::brickToIndex(const glm::i32vec3 &brick_coords) const
+{
+    assert(brick_coords.x >= 0 && brick_coords.x < m_bricks_size.x);
+    assert(brick_coords.y >= 0 && brick_coords.y < m_bricks_size.y);
+    assert(brick_coords.z >= 0 && brick_coords.z < m_bricks_size.z);
+    return (brick_coords.y * m_bricks_size.z + brick_coords.z) * m_bricks_size.x + brick_coords.x;
+}
+
+} // namespace eb
+
+#endif // EB_VOXEL_CHUNKOCCUPANCY_H
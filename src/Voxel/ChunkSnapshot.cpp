@@ -0,0 +1,25 @@
+#include "ChunkSnapshot.h"
+
+namespace eb {
+
+ChunkSnapshot::ChunkSnapshot(const glm::i32vec3 &chunk_coords, const glm::i32vec3 &chunk_size)
+    : m_chunk_coords{chunk_coords}
+    , m_chunk_size{chunk_size}
+{}
+
+const glm::i32vec3 &ChunkSnapshot::getChunkCoords() const
+{
+    return m_chunk_coords;
+}
+
+const glm::i32vec3 &ChunkSnapshot::getChunkSize() const
+{
+    return m_chunk_size;
+}
+
+const ChunkSnapshot::Entry &ChunkSnapshot::getEntry(const glm::i32vec3 &offset) const
+{
+    return m_entries[offsetToIndex(offset)];
+}
+
+} // namespace eb
@@ -0,0 +1,100 @@
+#ifndef EB_VOXEL_CHUNKSNAPSHOT_H
+#define EB_VOXEL_CHUNKSNAPSHOT_H
+
+#include "../VoxelLigtning/Lightmap.h"
+#include "VoxelStorage.h"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <assert.h>
+#include <memory>
+#include <stdint.h>
+
+namespace eb {
+
+// Immutable view of a chunk and its 26 neighbours that any thread may read.
+// It shares the chunk data, the owning chunk copies its data before the next
+// edit instead of changing it under the readers.
+class ChunkSnapshot
+{
+    friend class Chunks;
+
+public:
+    struct Entry
+    {
+        // Chunk version at the time of the snapshot, 0 for missing chunks
+        uint64_t version = 0;
+        std::shared_ptr<const VoxelStorage> voxels;
+        std::shared_ptr<const Lightmap> light_map;
+    };
+
+    ChunkSnapshot(const glm::i32vec3 &chunk_coords, const glm::i32vec3 &chunk_size);
+    ~ChunkSnapshot() = default;
+
+    const glm::i32vec3 &getChunkCoords() const;
+    const glm::i32vec3 &getChunkSize() const;
+
+    // Chunk at offset in [-1, 1] per axis, offset zero is the snapshot chunk
+    const Entry &getEntry(const glm::i32vec3 &offset) const;
+
+    // Voxel coords local to the snapshot chunk, at most one chunk outside it.
+    // Voxels of missing chunks are nullptr and their light is 0.
+    const Voxel *getVoxel(const glm::i32vec3 &voxel_coords) const;
+    uint8_t getLight(const glm::i32vec3 &voxel_coords, int32_t channel) const;
+
+private:
+    // Entry of the voxel and its coords local to the entry chunk
+    const Entry &resolve(const glm::i32vec3 &voxel_coords, glm::i32vec3 &local_coords) const;
+
+    static int32_t offsetToIndex(const glm::i32vec3 &offset);
+
+private:
+    glm::i32vec3 m_chunk_coords;
+    glm::i32vec3 m_chunk_size;
+    std::array<Entry, 27> m_entries;
+};
+
+inline const Voxel *ChunkSnapshot::getVoxel(const glm::i32vec3 &voxel_coords) const
+{
+    glm::i32vec3 local_coords;
+    const Entry &entry = resolve(voxel_coords, local_coords);
+    if (!entry.voxels)
+        return nullptr;
+    return &entry.voxels->get((local_coords.y * m_chunk_size.z + local_coords.z) * m_chunk_size.x
+                              + local_coords.x);
+}
+
+inline uint8_t ChunkSnapshot::getLight(const glm::i32vec3 &voxel_coords, int32_t channel) const
+{
+    glm::i32vec3 local_coords;
+    const Entry &entry = resolve(voxel_coords, local_coords);
+    return entry.light_map ? entry.light_map->get(local_coords, channel) : 0;
+}
+
+inline const ChunkSnapshot::Entry &ChunkSnapshot::resolve(const glm::i32vec3 &voxel_coords,
+                                                          glm::i32vec3 &local_coords) const
+{
+    glm::i32vec3 offset{0};
+    local_coords = voxel_coords;
+    for (int32_t i = 0; i < 3; ++i) {
+        assert(voxel_coords[i] >= -m_chunk_size[i] && voxel_coords[i] < 2 * m_chunk_size[i]);
+        if (local_coords[i] < 0) {
+            offset[i] = -1;
+            local_coords[i] += m_chunk_size[i];
+        } else if (local_coords[i] >= m_chunk_size[i]) {
+            offset[i] = 1;
+            local_coords[i] -= m_chunk_size[i];
+        }
+    }
+    return m_entries[offsetToIndex(offset)];
+}
+
+inline int32_t ChunkSnapshot::offsetToIndex(const glm::i32vec3 &offset)
+{
+    return ((offset.y + 1) * 3 + offset.z + 1) * 3 + offset.x + 1;
+}
+
+} // namespace eb
+
+#endif // EB_VOXEL_CHUNKSNAPSHOT_H
@@ -1,53 +1,154 @@
 #include "Chunks.h"
 #include "../Graphics/Common/RenderTarget.h"
+#include "../System/Clock.h"
+#include "../Utils/VecUtils.h"
 
-#include <glm/gtc/noise.hpp>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+#include <limits>
+#include <random>
+
 namespace eb {
 
+// The default terrain keeps the shape of the single octave glm::perlin field
+// it was made with, gradient noise of the same frequencies and range. More
+// octaves would add detail but change the world of every existing seed.
+static constexpr int32_t TERRAIN_OCTAVES = 1;
+static constexpr float TERRAIN_LACUNARITY = 2.0f;
+static constexpr float TERRAIN_GAIN = 0.5f;
+
+// Density field of the default terrain, frequencies are per voxel
+static NoiseCache::Field getTerrainField(const glm::i32vec3 &chunk_size)
+{
+    NoiseCache::Field field;
+    field.frequency = glm::vec3{chunk_size.x * 0.005625f,
+                                chunk_size.y * 0.009625f,
+                                chunk_size.z * 0.00525f};
+    field.octaves = TERRAIN_OCTAVES;
+    field.lacunarity = TERRAIN_LACUNARITY;
+    field.gain = TERRAIN_GAIN;
+    return field;
+}
+
+static uint64_t splitMix64(uint64_t value)
+{
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
 Chunks::Chunks(const glm::i32vec3 &chunks_size,
                const glm::i32vec3 &chunk_size,
                float voxel_size,
                float texture_size,
                const std::shared_ptr<Texture> &atlas_texture,
-               Engine *engine)
+               Engine *engine,
+               const std::filesystem::path &storage_path)
     : EngineObject{engine}
     , m_chunks_size{chunks_size}
     , m_chunk_size{chunk_size}
+    , m_pow2_chunk_size{isPowerOfTwo(chunk_size)}
+    , m_chunk_shift{m_pow2_chunk_size ? log2PowerOfTwo(chunk_size) : glm::i32vec3{0}}
+    , m_chunk_mask{chunk_size - 1}
     , m_voxel_size{voxel_size}
     , m_texture_size{texture_size}
     , m_atlas_texture{atlas_texture}
+    , m_streaming{false}
+    , m_view_radius{0}
+    , m_unload_radius{0}
+    , m_max_chunk_loads{0}
+    , m_focus_chunk{0}
+    , m_focus_changed{false}
+    , m_block_registry_version{m_block_registry.getVersion()}
+    , m_storage{storage_path.empty() ? nullptr : std::make_unique<RegionStorage>(storage_path)}
+    , m_journal{storage_path.empty() ? nullptr
+                                     : std::make_unique<EditJournal>(storage_path / "journal.log")}
+    , m_save_interval{seconds(300.0f)}
+    , m_seed{0}
+    , m_noise{0}
+    , m_noise_cache{m_noise, m_chunk_size, m_chunks_size.y}
+    , m_generation_stages{[this](Chunk *chunk, const ChunkSnapshot &, uint64_t) {
+        setChunkData(chunk);
+    }}
+    , m_generating_chunks{0}
+    , m_lod_enabled{false}
     , m_chunks_modfied{false}
+    , m_memory_log_interval{seconds(60.0f)}
+    , m_update_time{Clock::getCurrentTime()}
+    , m_compressions_count{0}
+    , m_decompressions_count{0}
+    , m_decompress_time{0}
+    , m_max_decompress_time{0}
 {
-    m_chunk_states.resize(m_chunks_size.x * m_chunks_size.y * m_chunks_size.z);
-
-    // Create chunks
-    for (int32_t y = 0; y < m_chunks_size.y; ++y) {
-        for (int32_t z = 0; z < m_chunks_size.z; ++z) {
-            for (int32_t x = 0; x < m_chunks_size.x; ++x) {
-                glm::i32vec3 chunk_coords = {x, y, z};
-
-                auto chunk_state = std::make_unique<ChunkState>(chunk_coords,
-                                                                this,
-                                                                atlas_texture,
-                                                                engine);
-                chunk_state->mesh->setPosition(static_cast<glm::vec3>(chunk_coords)
-                                               * static_cast<glm::vec3>(chunk_size) * voxel_size);
-
-                m_chunk_states[chunkCoordsToIndex({x, y, z})] = std::move(chunk_state);
-            }
+    m_noise_cache.setDensityField(getTerrainField(m_chunk_size));
+    loadJournal();
+
+    // Chunks are created and generated in update(). Stacked chunks are queued
+    // together so they reuse their noise column before the cache drops it.
+    for (int32_t z = 0; z < m_chunks_size.z; ++z) {
+        for (int32_t x = 0; x < m_chunks_size.x; ++x) {
+            for (int32_t y = 0; y < m_chunks_size.y; ++y)
+                m_load_queue.push_back({x, y, z});
         }
     }
+}
 
-    for (int32_t y = 0; y < m_chunks_size.y; ++y) {
-        for (int32_t z = 0; z < m_chunks_size.z; ++z) {
-            for (int32_t x = 0; x < m_chunks_size.x; ++x) {
-                glm::i32vec3 chunk_coords = {x, y, z};
-                setChunkData(chunk_coords);
-            }
-        }
-    }
+Chunks::Chunks(int32_t chunks_height,
+               int32_t view_radius,
+               int32_t unload_radius,
+               const glm::i32vec3 &chunk_size,
+               float voxel_size,
+               float texture_size,
+               const std::shared_ptr<Texture> &atlas_texture,
+               Engine *engine,
+               const std::filesystem::path &storage_path)
+    : EngineObject{engine}
+    , m_chunks_size{0, chunks_height, 0}
+    , m_chunk_size{chunk_size}
+    , m_pow2_chunk_size{isPowerOfTwo(chunk_size)}
+    , m_chunk_shift{m_pow2_chunk_size ? log2PowerOfTwo(chunk_size) : glm::i32vec3{0}}
+    , m_chunk_mask{chunk_size - 1}
+    , m_voxel_size{voxel_size}
+    , m_texture_size{texture_size}
+    , m_atlas_texture{atlas_texture}
+    , m_streaming{true}
+    , m_view_radius{0}
+    , m_unload_radius{0}
+    , m_max_chunk_loads{4}
+    , m_focus_chunk{0}
+    , m_focus_changed{true}
+    , m_block_registry_version{m_block_registry.getVersion()}
+    , m_storage{storage_path.empty() ? nullptr : std::make_unique<RegionStorage>(storage_path)}
+    , m_journal{storage_path.empty() ? nullptr
+                                     : std::make_unique<EditJournal>(storage_path / "journal.log")}
+    , m_save_interval{seconds(300.0f)}
+    , m_seed{0}
+    , m_noise{0}
+    , m_noise_cache{m_noise, m_chunk_size, m_chunks_size.y}
+    , m_generation_stages{[this](Chunk *chunk, const ChunkSnapshot &, uint64_t) {
+        setChunkData(chunk);
+    }}
+    , m_generating_chunks{0}
+    , m_lod_enabled{false}
+    , m_chunks_modfied{false}
+    , m_memory_log_interval{seconds(60.0f)}
+    , m_update_time{Clock::getCurrentTime()}
+    , m_compressions_count{0}
+    , m_decompressions_count{0}
+    , m_decompress_time{0}
+    , m_max_decompress_time{0}
+{
+    m_noise_cache.setDensityField(getTerrainField(m_chunk_size));
+    loadJournal();
+    setViewRadius(view_radius, unload_radius);
+}
+
+Chunks::~Chunks()
+{
+    m_thread_pool.wait();
+    save();
 }
 
 const glm::i32vec3 &Chunks::getChunksSize() const
@@ -75,320 +176,1878 @@ std::shared_ptr<Texture> Chunks::getAtlasTexture() const
     return m_atlas_texture;
 }
 
+bool Chunks::isStreaming() const
+{
+    return m_streaming;
+}
+
+int32_t Chunks::getViewRadius() const
+{
+    return m_view_radius;
+}
+
+int32_t Chunks::getUnloadRadius() const
+{
+    return m_unload_radius;
+}
+
+void Chunks::setViewRadius(int32_t view_radius, int32_t unload_radius)
+{
+    // Keep a gap between the radii so chunks on the border do not reload
+    // every time the focus crosses a chunk boundary
+    m_view_radius = std::max(view_radius, 0);
+    m_unload_radius = std::max(unload_radius, m_view_radius + 1);
+    m_focus_changed = true;
+}
+
+int32_t Chunks::getMaxChunkLoadsPerUpdate() const
+{
+    return m_max_chunk_loads;
+}
+
+void Chunks::setMaxChunkLoadsPerUpdate(int32_t max_chunk_loads)
+{
+    m_max_chunk_loads = std::max(max_chunk_loads, 1);
+}
+
+const glm::i32vec3 &Chunks::getFocusChunk() const
+{
+    return m_focus_chunk;
+}
+
+void Chunks::setFocus(const glm::vec3 &global_coords)
+{
+    glm::i32vec3 focus_chunk = toChunkCoords(toVoxelCoords(global_coords));
+    focus_chunk.y = 0;
+
+    if (focus_chunk != m_focus_chunk) {
+        m_focus_chunk = focus_chunk;
+        m_focus_changed = true;
+    }
+}
+
+int32_t Chunks::getLoadedChunksCount() const
+{
+    return m_chunk_states.getSize();
+}
+
+BlockRegistry &Chunks::getBlockRegistry()
+{
+    return m_block_registry;
+}
+
+const BlockRegistry &Chunks::getBlockRegistry() const
+{
+    return m_block_registry;
+}
+
+RegionStorage *Chunks::getStorage() const
+{
+    return m_storage.get();
+}
+
+void Chunks::save()
+{
+    if (!m_storage)
+        return;
+
+    int32_t saved_chunks = 0;
+    int32_t failed_chunks = 0;
+    m_chunk_states.forEach(
+        [this, &saved_chunks, &failed_chunks](const glm::i32vec3 &,
+                                              PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state != ChunkState::GENERATED || !chunk_state->chunk->isUnsaved())
+                return;
+
+            if (m_storage->saveChunk(chunk_state->chunk.get()))
+                ++saved_chunks;
+            else
+                ++failed_chunks;
+        });
+
+    spdlog::debug("Chunks saved: {}", saved_chunks);
+
+    // Region files write their tables on sync. The journal keeps only the
+    // edits of chunks not loaded yet, edits of chunks that failed to save
+    // have no other copy
+    const bool synced = m_storage->sync();
+    if (m_journal && failed_chunks == 0 && synced) {
+        std::vector<EditJournal::Record> records;
+        m_journal_edits.forEach(
+            [&records](const glm::i32vec3 &, const std::vector<EditJournal::Record> &edits) {
+                records.insert(records.end(), edits.begin(), edits.end());
+            });
+        m_journal->compact(records);
+    }
+}
+
+EditJournal *Chunks::getJournal() const
+{
+    return m_journal.get();
+}
+
+const Time &Chunks::getSaveInterval() const
+{
+    return m_save_interval;
+}
+
+void Chunks::setSaveInterval(const Time &interval)
+{
+    m_save_interval = interval;
+}
+
+const Noise &Chunks::getNoise() const
+{
+    return m_noise;
+}
+
+NoiseCache &Chunks::getNoiseCache()
+{
+    return m_noise_cache;
+}
+
+uint64_t Chunks::getSeed() const
+{
+    return m_seed;
+}
+
+void Chunks::setSeed(uint64_t seed)
+{
+    m_seed = seed;
+    m_noise.setSeed(static_cast<uint32_t>(seed ^ (seed >> 32)));
+    m_noise_cache.clear();
+}
+
+uint64_t Chunks::getChunkSeed(const glm::i32vec3 &chunk_coords) const
+{
+    // Every coordinate goes through a full mix, neighbour chunks get unrelated seeds
+    uint64_t value = splitMix64(m_seed ^ static_cast<uint32_t>(chunk_coords.x));
+    value = splitMix64(value ^ static_cast<uint32_t>(chunk_coords.y));
+    return splitMix64(value ^ static_cast<uint32_t>(chunk_coords.z));
+}
+
+void Chunks::setGenerator(const ChunkGenerator &generator)
+{
+    setGenerationStage(GenerationStage::TERRAIN,
+                       [generator](Chunk *chunk, const ChunkSnapshot &, uint64_t chunk_seed) {
+                           generator(chunk, chunk_seed);
+                       });
+}
+
+void Chunks::setGenerationStage(GenerationStage stage, const GenerationStageFunc &func)
+{
+    m_generation_stages[static_cast<int32_t>(stage)] = func;
+}
+
+ThreadPool &Chunks::getThreadPool()
+{
+    return m_thread_pool;
+}
+
+int32_t Chunks::getGeneratingChunksCount() const
+{
+    return m_generating_chunks;
+}
+
+bool Chunks::isLodEnabled() const
+{
+    return m_lod_enabled;
+}
+
+void Chunks::setLodEnabled(bool enabled)
+{
+    m_lod_enabled = enabled;
+    if (!m_lod_enabled)
+        return;
+
+    m_chunk_states.forEach(
+        [](const glm::i32vec3 &, const PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state == ChunkState::GENERATED)
+                chunk_state->chunk->getLod();
+        });
+}
+
+Chunks::LodCell Chunks::getLodCell(int32_t level, const glm::i32vec3 &cell_coords) const
+{
+    LodCell cell;
+    if (level <= 0) {
+        if (auto voxel = getVoxel(cell_coords)) {
+            cell.volume = 1;
+            if (voxel->id != 0) {
+                cell.occupied_count = 1;
+                cell.material = *voxel;
+            }
+        }
+        return cell;
+    }
+
+    const glm::i32vec3 min_voxel = cell_coords << level;
+    const glm::i32vec3 max_voxel = ((cell_coords + 1) << level) - 1;
+    const glm::i32vec3 min_chunk = toChunkCoords(min_voxel);
+    const glm::i32vec3 max_chunk = toChunkCoords(max_voxel);
+
+    // Cells up to a chunk read one pyramid cell, larger cells merge whole chunks
+    glm::i32vec3 chunk_coords;
+    for (chunk_coords.y = min_chunk.y; chunk_coords.y <= max_chunk.y; ++chunk_coords.y) {
+        for (chunk_coords.z = min_chunk.z; chunk_coords.z <= max_chunk.z; ++chunk_coords.z) {
+            for (chunk_coords.x = min_chunk.x; chunk_coords.x <= max_chunk.x; ++chunk_coords.x) {
+                Chunk *chunk = findChunk(chunk_coords);
+                if (!chunk)
+                    continue;
+
+                // Part of the chunk inside the cell, inclusive
+                const glm::i32vec3 chunk_min = chunk_coords * m_chunk_size;
+                const glm::i32vec3 local_min = glm::max(min_voxel - chunk_min, glm::i32vec3{0});
+                const glm::i32vec3 local_max = glm::min(max_voxel - chunk_min,
+                                                        m_chunk_size - 1);
+
+                // Coarsest pyramid level whose cells tile the part exactly,
+                // edge cells clipped by the chunk end with it
+                const ChunkLod &lod = chunk->getLod();
+                int32_t chunk_level = std::min(level, lod.getLevelsCount());
+                while (chunk_level > 0) {
+                    const int32_t mask = (1 << chunk_level) - 1;
+                    bool aligned = true;
+                    for (int32_t i = 0; i < 3; ++i) {
+                        aligned = aligned && (local_min[i] & mask) == 0
+                                  && (((local_max[i] + 1) & mask) == 0
+                                      || local_max[i] + 1 == m_chunk_size[i]);
+                    }
+                    if (aligned)
+                        break;
+                    --chunk_level;
+                }
+
+                const glm::i32vec3 min_cell = local_min >> chunk_level;
+                const glm::i32vec3 max_cell = local_max >> chunk_level;
+                glm::i32vec3 local_cell;
+                for (local_cell.y = min_cell.y; local_cell.y <= max_cell.y; ++local_cell.y) {
+                    for (local_cell.z = min_cell.z; local_cell.z <= max_cell.z; ++local_cell.z) {
+                        for (local_cell.x = min_cell.x; local_cell.x <= max_cell.x;
+                             ++local_cell.x) {
+                            if (chunk_level == 0) {
+                                const Voxel &voxel = chunk->getVoxels().get(
+                                    chunk->voxelCoordsToIndex(local_cell));
+                                cell.volume += 1;
+                                cell.occupied_count += voxel.id != 0;
+                                if (cell.material.id == 0)
+                                    cell.material = voxel;
+                                continue;
+                            }
+
+                            cell.occupied_count += lod.getOccupiedCount(chunk_level, local_cell);
+                            cell.volume += lod.getVolume(chunk_level, local_cell);
+                            if (cell.material.id == 0)
+                                cell.material = lod.getMaterial(chunk_level, local_cell);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return cell;
+}
+
+bool Chunks::isPowerOfTwoChunkSize() const
+{
+    return m_pow2_chunk_size;
+}
+
+glm::i32vec3 Chunks::toVoxelCoords(const glm::vec3 &global_coords) const
+{
+    return static_cast<glm::i32vec3>(glm::floor(global_coords / m_voxel_size));
+}
+
 Chunk *Chunks::getChunk(const glm::i32vec3 &chunk_coords)
 {
-    if (!containsChunk(chunk_coords))
-        return nullptr;
-    return m_chunk_states[chunkCoordsToIndex(chunk_coords)]->chunk.get();
+    Chunk *chunk = findChunk(chunk_coords);
+    if (chunk)
+        chunk->touch(m_update_time);
+    return chunk;
 }
 
 Chunk *Chunks::getChunkByVoxel(const glm::i32vec3 &voxel_coords)
 {
-    if (!containsVoxel(voxel_coords))
-        return nullptr;
+    return getChunk(toChunkCoords(voxel_coords));
+}
 
-    auto chunk_coords = voxel_coords / m_chunk_size;
-    if (!containsChunk(chunk_coords))
-        return nullptr;
+Chunk *Chunks::getChunkByGlobal(const glm::vec3 &global_coords)
+{
+    return getChunkByVoxel(toVoxelCoords(global_coords));
+}
 
-    return m_chunk_states[chunkCoordsToIndex(chunk_coords)]->chunk.get();
+std::optional<Voxel> Chunks::getVoxelByGlobal(const glm::vec3 &global_coords) const
+{
+    return getVoxel(toVoxelCoords(global_coords));
 }
 
-Chunk *Chunks::getChunkByGlobal(const glm::vec3 &global_coords)
+void Chunks::setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel)
 {
-    return getChunkByVoxel(static_cast<glm::i32vec3>(global_coords / m_voxel_size));
+    auto chunk_coords = toChunkCoords(voxel_coords);
+    Chunk *chunk = findChunk(chunk_coords);
+    if (!chunk)
+        return;
+
+    auto local_voxel_coords = toLocalCoords(voxel_coords);
+    if (!chunk->setVoxel(local_voxel_coords, voxel))
+        return;
+
+    if (local_voxel_coords.x == 0)
+        markChunkModified(chunk_coords + glm::i32vec3{-1, 0, 0});
+
+    if (local_voxel_coords.x == (m_chunk_size.x - 1))
+        markChunkModified(chunk_coords + glm::i32vec3{1, 0, 0});
+
+    if (local_voxel_coords.y == 0)
+        markChunkModified(chunk_coords + glm::i32vec3{0, -1, 0});
+
+    if (local_voxel_coords.y == (m_chunk_size.y - 1))
+        markChunkModified(chunk_coords + glm::i32vec3{0, 1, 0});
+
+    if (local_voxel_coords.z == 0)
+        markChunkModified(chunk_coords + glm::i32vec3{0, 0, -1});
+
+    if (local_voxel_coords.z == (m_chunk_size.z - 1))
+        markChunkModified(chunk_coords + glm::i32vec3{0, 0, 1});
+
+    journalEdit(chunk, chunk->voxelCoordsToIndex(local_voxel_coords), voxel);
 }
 
-const Voxel *Chunks::getVoxel(const glm::i32vec3 &voxel_coords) const
+void Chunks::setVoxelByGlobal(const glm::vec3 &global_coords, const Voxel &voxel)
 {
-    if (!containsVoxel(voxel_coords))
-        return nullptr;
-    auto chunk_coords = voxel_coords / m_chunk_size;
-    return m_chunk_states[chunkCoordsToIndex(chunk_coords)]->chunk->getVoxel(voxel_coords
-                                                                             % m_chunk_size);
+    setVoxel(toVoxelCoords(global_coords), voxel);
 }
 
-const Voxel *Chunks::getVoxelByGlobal(const glm::vec3 &global_coords) const
+int32_t Chunks::fillBox(const glm::i32vec3 &min_voxel,
+                        const glm::i32vec3 &max_voxel,
+                        const Voxel &voxel)
 {
-    return getVoxel(static_cast<glm::i32vec3>(global_coords / m_voxel_size));
+    return editChunks(min_voxel,
+                      max_voxel,
+                      [this, &voxel](Chunk *chunk,
+                                     const glm::i32vec3 &local_min,
+                                     const glm::i32vec3 &local_max,
+                                     glm::i32vec3 &changed_min,
+                                     glm::i32vec3 &changed_max) {
+                          if (local_min == glm::i32vec3{0} && local_max == m_chunk_size - 1) {
+                              changed_min = local_min;
+                              changed_max = local_max;
+                              return fillChunk(chunk, voxel);
+                          }
+
+                          return editVoxels(
+                              chunk,
+                              local_min,
+                              local_max,
+                              [&voxel](const glm::i32vec3 &, Voxel &value) {
+                                  value = voxel;
+                                  return true;
+                              },
+                              changed_min,
+                              changed_max);
+                      });
 }
 
-void Chunks::setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel)
+int32_t Chunks::fillSphere(const glm::i32vec3 &center, int32_t radius, const Voxel &voxel)
 {
-    if (!containsVoxel(voxel_coords))
+    const int64_t radius_squared = static_cast<int64_t>(radius) * radius;
+    auto is_inside = [&center, radius_squared](const glm::i32vec3 &voxel_coords) {
+        const int64_t dx = voxel_coords.x - center.x;
+        const int64_t dy = voxel_coords.y - center.y;
+        const int64_t dz = voxel_coords.z - center.z;
+        return dx * dx + dy * dy + dz * dz <= radius_squared;
+    };
+
+    return editChunks(
+        center - radius,
+        center + radius,
+        [this, &voxel, &is_inside](Chunk *chunk,
+                                   const glm::i32vec3 &local_min,
+                                   const glm::i32vec3 &local_max,
+                                   glm::i32vec3 &changed_min,
+                                   glm::i32vec3 &changed_max) {
+            // The sphere is convex, so a chunk with all corners inside is covered
+            const glm::i32vec3 offset = chunk->getPosition() * m_chunk_size;
+            const glm::i32vec3 last = m_chunk_size - 1;
+            bool covered = local_min == glm::i32vec3{0} && local_max == last;
+            for (int32_t corner = 0; covered && corner < 8; ++corner)
+                covered = is_inside(offset
+                                    + glm::i32vec3{corner & 1 ? last.x : 0,
+                                                   corner & 2 ? last.y : 0,
+                                                   corner & 4 ? last.z : 0});
+
+            if (covered) {
+                changed_min = local_min;
+                changed_max = local_max;
+                return fillChunk(chunk, voxel);
+            }
+
+            return editVoxels(
+                chunk,
+                local_min,
+                local_max,
+                [&voxel, &is_inside](const glm::i32vec3 &voxel_coords, Voxel &value) {
+                    if (!is_inside(voxel_coords))
+                        return false;
+                    value = voxel;
+                    return true;
+                },
+                changed_min,
+                changed_max);
+        });
+}
+
+int32_t Chunks::replace(const glm::i32vec3 &min_voxel,
+                        const glm::i32vec3 &max_voxel,
+                        const Voxel &from,
+                        const Voxel &to)
+{
+    return editChunks(min_voxel,
+                      max_voxel,
+                      [this, &from, &to](Chunk *chunk,
+                                         const glm::i32vec3 &local_min,
+                                         const glm::i32vec3 &local_max,
+                                         glm::i32vec3 &changed_min,
+                                         glm::i32vec3 &changed_max) {
+                          // Palette tells whether the chunk holds the voxel at all
+                          const int32_t count = chunk->getVoxels().getCount(from);
+                          if (count == 0)
+                              return 0;
+
+                          if (count == chunk->getVoxels().getSize() && local_min == glm::i32vec3{0}
+                              && local_max == m_chunk_size - 1) {
+                              changed_min = local_min;
+                              changed_max = local_max;
+                              return fillChunk(chunk, to);
+                          }
+
+                          return editVoxels(
+                              chunk,
+                              local_min,
+                              local_max,
+                              [&from, &to](const glm::i32vec3 &, Voxel &value) {
+                                  if (value.id != from.id)
+                                      return false;
+                                  value = to;
+                                  return true;
+                              },
+                              changed_min,
+                              changed_max);
+                      });
+}
+
+int32_t Chunks::applyBrush(const glm::i32vec3 &min_voxel,
+                           const glm::i32vec3 &max_voxel,
+                           const VoxelBrush &brush)
+{
+    if (!brush)
+        return 0;
+
+    return editChunks(min_voxel,
+                      max_voxel,
+                      [this, &brush](Chunk *chunk,
+                                     const glm::i32vec3 &local_min,
+                                     const glm::i32vec3 &local_max,
+                                     glm::i32vec3 &changed_min,
+                                     glm::i32vec3 &changed_max) {
+                          return editVoxels(
+                              chunk, local_min, local_max, brush, changed_min, changed_max);
+                      });
+}
+
+int32_t Chunks::stampSchematic(const Schematic &schematic,
+                               const glm::i32vec3 &origin,
+                               bool skip_air)
+{
+    const VoxelStorage &voxels = schematic.getVoxels();
+    const glm::i32vec3 max_voxel = origin + schematic.getSize() - 1;
+    if (voxels.isUniform()) {
+        const Voxel &voxel = voxels.getPalette().front();
+        return skip_air && voxel.id == 0 ? 0 : fillBox(origin, max_voxel, voxel);
+    }
+
+    return editChunks(
+        origin,
+        max_voxel,
+        [this, &schematic, &voxels, &origin, skip_air](Chunk *chunk,
+                                                       const glm::i32vec3 &local_min,
+                                                       const glm::i32vec3 &local_max,
+                                                       glm::i32vec3 &changed_min,
+                                                       glm::i32vec3 &changed_max) {
+            return editVoxels(
+                chunk,
+                local_min,
+                local_max,
+                [&schematic, &voxels, &origin, skip_air](const glm::i32vec3 &voxel_coords,
+                                                         Voxel &voxel) {
+                    const Voxel &value = voxels.get(
+                        schematic.voxelCoordsToIndex(voxel_coords - origin));
+                    if (skip_air && value.id == 0)
+                        return false;
+                    voxel = value;
+                    return true;
+                },
+                changed_min,
+                changed_max);
+        });
+}
+
+Schematic Chunks::copySchematic(const glm::i32vec3 &min_voxel, const glm::i32vec3 &max_voxel) const
+{
+    Schematic schematic{max_voxel - min_voxel + 1};
+    glm::i32vec3 voxel_coords;
+    for (voxel_coords.y = 0; voxel_coords.y < schematic.getSize().y; ++voxel_coords.y) {
+        for (voxel_coords.z = 0; voxel_coords.z < schematic.getSize().z; ++voxel_coords.z) {
+            for (voxel_coords.x = 0; voxel_coords.x < schematic.getSize().x; ++voxel_coords.x) {
+                auto voxel = getVoxel(min_voxel + voxel_coords);
+                if (voxel && voxel->id != 0)
+                    schematic.setVoxel(voxel_coords, *voxel);
+            }
+        }
+    }
+    return schematic;
+}
+
+std::optional<Voxel> Chunks::rayCast(glm::vec3 start,
+                                     glm::vec3 direction,
+                                     float max_dist,
+                                     glm::vec3 &end,
+                                     glm::vec3 &norm,
+                                     glm::vec3 &iend)
+{
+    const Ray ray{start, direction, max_dist * m_voxel_size};
+    RayHit hit;
+    rayCastPacket(&ray, &hit, 1);
+
+    end = hit.position;
+    norm = hit.normal;
+    iend = static_cast<glm::vec3>(hit.voxel_coords);
+    return hit.hit ? getVoxel(hit.voxel_coords) : std::nullopt;
+}
+
+void Chunks::rayCastBatch(std::span<const Ray> rays, std::span<RayHit> hits) const
+{
+    assert(hits.size() >= rays.size());
+
+    for (size_t first = 0; first < rays.size(); first += RAY_PACKET_SIZE)
+        rayCastPacket(rays.data() + first,
+                      hits.data() + first,
+                      std::min<size_t>(RAY_PACKET_SIZE, rays.size() - first));
+}
+
+void Chunks::rayCastBatchParallel(std::span<const Ray> rays, std::span<RayHit> hits)
+{
+    assert(hits.size() >= rays.size());
+
+    const int32_t packets_count = (rays.size() + RAY_PACKET_SIZE - 1) / RAY_PACKET_SIZE;
+    if (packets_count == 0)
+        return;
+
+    const int32_t tasks_count = std::min(packets_count, m_thread_pool.getThreadsCount() * 4);
+    std::latch tasks_latch{tasks_count};
+    for (int32_t task = 0; task < tasks_count; ++task) {
+        m_thread_pool.enqueue([this, rays, hits, &tasks_latch, task, tasks_count, packets_count]() {
+            for (int32_t packet = task; packet < packets_count; packet += tasks_count) {
+                const size_t first = static_cast<size_t>(packet) * RAY_PACKET_SIZE;
+                rayCastPacket(rays.data() + first,
+                              hits.data() + first,
+                              std::min<size_t>(RAY_PACKET_SIZE, rays.size() - first));
+            }
+            tasks_latch.count_down();
+        });
+    }
+    tasks_latch.wait();
+}
+
+void Chunks::benchmarkRayCasts(int32_t rays_count)
+{
+    std::vector<glm::i32vec3> chunks;
+    m_chunk_states.forEach(
+        [&chunks](const glm::i32vec3 &chunk_coords,
+                  const PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state == ChunkState::GENERATED)
+                chunks.push_back(chunk_coords);
+        });
+
+    if (chunks.empty() || rays_count <= 0)
+        return;
+
+    std::mt19937 random{static_cast<uint32_t>(m_seed)};
+    std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+    std::uniform_int_distribution<size_t> chunk_index{0, chunks.size() - 1};
+
+    std::vector<Ray> rays(rays_count);
+    std::vector<RayHit> hits(rays_count);
+
+    for (int32_t max_voxels : {8, 128}) {
+        for (auto &ray : rays) {
+            const glm::vec3 in_chunk{unit(random), unit(random), unit(random)};
+            ray.origin = (static_cast<glm::vec3>(chunks[chunk_index(random)] * m_chunk_size)
+                          + in_chunk * static_cast<glm::vec3>(m_chunk_size))
+                         * m_voxel_size;
+
+            const float theta = unit(random) * 6.2831853f;
+            const float cos_phi = unit(random) * 2.0f - 1.0f;
+            const float sin_phi = std::sqrt(1.0f - cos_phi * cos_phi);
+            ray.direction = {sin_phi * std::cos(theta), cos_phi, sin_phi * std::sin(theta)};
+            ray.max_dist = max_voxels * m_voxel_size;
+        }
+
+        Clock clock;
+        rayCastBatch(rays, hits);
+        const float seconds = clock.getElapsedTime().asSeconds();
+
+        clock.restart();
+        rayCastBatchParallel(rays, hits);
+        const float parallel_seconds = clock.getElapsedTime().asSeconds();
+
+        const auto hits_count = std::count_if(hits.begin(), hits.end(), [](const RayHit &hit) {
+            return hit.hit;
+        });
+
+        spdlog::info("Ray casts of {} voxels: {:.2f} Mrays/s, {:.2f} Mrays/s on {} threads, "
+                     "{}% hit",
+                     max_voxels,
+                     rays_count * 1e-6f / std::max(seconds, 1e-6f),
+                     rays_count * 1e-6f / std::max(parallel_seconds, 1e-6f),
+                     m_thread_pool.getThreadsCount(),
+                     hits_count * 100 / rays_count);
+    }
+}
+
+void Chunks::benchmarkVoxelVisits(int32_t passes)
+{
+    int32_t chunks_count = 0;
+    m_chunk_states.forEach(
+        [&chunks_count](const glm::i32vec3 &, const PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state == ChunkState::GENERATED)
+                ++chunks_count;
+        });
+
+    if (chunks_count == 0 || passes <= 0)
         return;
 
-    auto chunk_coords = voxel_coords / m_chunk_size;
-    auto local_voxel_coords = voxel_coords % m_chunk_size;
+    // Rarely written, threads keep reading their cached copy
+    std::atomic<int32_t> max_id{0};
+    auto visit = [&max_id](const glm::i32vec3 &, const glm::i32vec3 &, const Voxel &voxel) {
+        int32_t current = max_id.load(std::memory_order_relaxed);
+        while (voxel.id > current
+               && !max_id.compare_exchange_weak(current, voxel.id, std::memory_order_relaxed)) {
+        }
+    };
+
+    Clock clock;
+    for (int32_t pass = 0; pass < passes; ++pass)
+        forEachVoxels(visit);
+    const float seconds = clock.getElapsedTime().asSeconds();
+
+    clock.restart();
+    for (int32_t pass = 0; pass < passes; ++pass)
+        forEachVoxelsParallel(visit);
+    const float parallel_seconds = clock.getElapsedTime().asSeconds();
+
+    const float voxels_count = static_cast<float>(passes) * chunks_count * m_chunk_size.x
+                               * m_chunk_size.y * m_chunk_size.z;
+    spdlog::info("Voxel visits of {} chunks: {:.2f} Mvoxels/s, {:.2f} Mvoxels/s on {} threads, "
+                 "max id {}",
+                 chunks_count,
+                 voxels_count * 1e-6f / std::max(seconds, 1e-6f),
+                 voxels_count * 1e-6f / std::max(parallel_seconds, 1e-6f),
+                 m_thread_pool.getThreadsCount(),
+                 max_id.load());
+}
+
+void Chunks::benchmarkMeshing(int32_t passes)
+{
+    std::vector<glm::i32vec3> chunks;
+    m_chunk_states.forEach(
+        [&chunks](const glm::i32vec3 &chunk_coords, const PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state == ChunkState::GENERATED)
+                chunks.push_back(chunk_coords);
+        });
+
+    if (chunks.empty() || passes <= 0)
+        return;
+
+    Clock clock;
+    for (int32_t pass = 0; pass < passes; ++pass) {
+        for (const auto &chunk_coords : chunks)
+            (*m_chunk_states.find(chunk_coords))->mesh->create(this, chunk_coords);
+    }
+    const float seconds = clock.getElapsedTime().asSeconds();
+
+    size_t gpu_bytes = 0;
+    for (const auto &chunk_coords : chunks)
+        gpu_bytes += (*m_chunk_states.find(chunk_coords))->mesh->getGpuMemoryUsage();
+
+    const float meshes_count = static_cast<float>(passes) * chunks.size();
+    spdlog::info("Chunk meshing of {} chunks: {:.1f} chunks/s, {:.3f} ms per chunk, {} KiB",
+                 chunks.size(),
+                 meshes_count / std::max(seconds, 1e-6f),
+                 seconds * 1e3f / meshes_count,
+                 gpu_bytes / 1024);
+}
+
+void Chunks::rayCastPacket(const Ray *rays, RayHit *hits, int32_t count) const
+{
+    constexpr int32_t N = RAY_PACKET_SIZE;
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    // Lanes are kept as structures of arrays so the stepping loop vectorizes,
+    // distances are in voxels
+    alignas(32) glm::vec3 directions[N];
+    alignas(32) float t_max[3][N];
+    alignas(32) float t_delta[3][N];
+    alignas(32) int32_t position[3][N];
+    alignas(32) int32_t step[3][N];
+    alignas(32) int32_t axis[N];
+    alignas(32) float t[N];
+    alignas(32) float max_t[N];
+    bool active[N];
+    bool jumped[N];
+    const Chunk *chunks[N];
+    glm::i32vec3 chunk_origins[N];
+
+    int32_t active_count = 0;
+    for (int32_t lane = 0; lane < N; ++lane) {
+        const float length = lane < count ? glm::length(rays[lane].direction) : 0.0f;
+        active[lane] = length > 0.0f;
+        chunks[lane] = nullptr;
+        chunk_origins[lane] = glm::i32vec3{0};
+        axis[lane] = -1;
+        t[lane] = 0.0f;
+        max_t[lane] = 0.0f;
+
+        if (!active[lane]) {
+            if (lane < count) {
+                hits[lane] = RayHit{};
+                hits[lane].voxel_coords = toVoxelCoords(rays[lane].origin);
+                hits[lane].position = rays[lane].origin;
+            }
+            for (int32_t i = 0; i < 3; ++i) {
+                t_max[i][lane] = t_delta[i][lane] = infinity;
+                position[i][lane] = step[i][lane] = 0;
+            }
+            continue;
+        }
 
-    if (local_voxel_coords.x == 0 && containsChunk(chunk_coords + glm::i32vec3{-1, 0, 0})) {
-        m_chunk_states[chunkCoordsToIndex(chunk_coords + glm::i32vec3{-1, 0, 0})]->chunk->m_modified
-            = true;
-        m_chunks_modfied = true;
+        ++active_count;
+        directions[lane] = rays[lane].direction / length;
+        max_t[lane] = rays[lane].max_dist / m_voxel_size;
+        const glm::vec3 origin = rays[lane].origin / m_voxel_size;
+
+        for (int32_t i = 0; i < 3; ++i) {
+            const float d = directions[lane][i];
+            position[i][lane] = std::floor(origin[i]);
+            step[i][lane] = d > 0.0f ? 1 : -1;
+            t_delta[i][lane] = d == 0.0f ? infinity : std::abs(1.0f / d);
+
+            const float dist = d > 0.0f ? position[i][lane] + 1 - origin[i]
+                                        : origin[i] - position[i][lane];
+            t_max[i][lane] = t_delta[i][lane] < infinity ? t_delta[i][lane] * dist : infinity;
+        }
     }
 
-    if (local_voxel_coords.x == (m_chunk_size.x - 1)
-        && containsChunk(chunk_coords + glm::i32vec3{1, 0, 0})) {
-        m_chunk_states[chunkCoordsToIndex(chunk_coords + glm::i32vec3{1, 0, 0})]->chunk->m_modified
-            = true;
-        m_chunks_modfied = true;
+    auto finish = [&](int32_t lane, const Voxel *voxel) {
+        const Ray &ray = rays[lane];
+        RayHit &hit = hits[lane];
+        hit.hit = voxel != nullptr;
+        hit.voxel = voxel ? *voxel : Voxel{};
+        hit.voxel_coords = {position[0][lane], position[1][lane], position[2][lane]};
+        hit.distance = std::min(t[lane], max_t[lane]) * m_voxel_size;
+        hit.position = ray.origin + directions[lane] * hit.distance;
+        hit.normal = glm::vec3{0.0f};
+        if (axis[lane] >= 0)
+            hit.normal[axis[lane]] = -step[axis[lane]][lane];
+
+        active[lane] = false;
+        --active_count;
+    };
+
+    // Moves the lane to the first voxel past the box [box_min, box_max) at once
+    auto jump = [&](int32_t lane, const glm::i32vec3 &box_min, const glm::i32vec3 &box_max) {
+        int32_t crossings[3];
+        float exit_t[3];
+        for (int32_t i = 0; i < 3; ++i) {
+            crossings[i] = step[i][lane] > 0 ? box_max[i] - position[i][lane]
+                                             : position[i][lane] - box_min[i] + 1;
+            exit_t[i] = t_delta[i][lane] < infinity
+                            ? t_max[i][lane] + (crossings[i] - 1) * t_delta[i][lane]
+                            : infinity;
+        }
+
+        // Same tie order as single steps
+        const int32_t exit_axis = exit_t[0] < exit_t[1] ? (exit_t[0] < exit_t[2] ? 0 : 2)
+                                                        : (exit_t[1] < exit_t[2] ? 1 : 2);
+        const float t_exit = exit_t[exit_axis];
+
+        for (int32_t i = 0; i < 3; ++i) {
+            // Other axes cross the boundaries they reach before the exit
+            int32_t steps_count = crossings[i];
+            if (i != exit_axis) {
+                steps_count = 0;
+                if (t_delta[i][lane] < infinity && t_max[i][lane] < t_exit) {
+                    steps_count = std::min<float>(std::ceil((t_exit - t_max[i][lane])
+                                                            / t_delta[i][lane]),
+                                                  crossings[i] - 1);
+                    while (steps_count > 0
+                           && t_max[i][lane] + (steps_count - 1) * t_delta[i][lane] >= t_exit)
+                        --steps_count;
+                    while (steps_count < crossings[i] - 1
+                           && t_max[i][lane] + steps_count * t_delta[i][lane] < t_exit)
+                        ++steps_count;
+                }
+            }
+
+            // Axes the ray runs parallel to keep an infinite t_max
+            if (steps_count > 0) {
+                position[i][lane] += steps_count * step[i][lane];
+                t_max[i][lane] += steps_count * t_delta[i][lane];
+            }
+        }
+
+        t[lane] = t_exit;
+        axis[lane] = exit_axis;
+        jumped[lane] = true;
+    };
+
+    while (active_count > 0) {
+        for (int32_t lane = 0; lane < N; ++lane) {
+            jumped[lane] = false;
+            if (!active[lane])
+                continue;
+
+            const glm::i32vec3 voxel_coords{position[0][lane],
+                                            position[1][lane],
+                                            position[2][lane]};
+            glm::i32vec3 local = voxel_coords - chunk_origins[lane];
+
+            // The cached chunk is only looked up again once the ray leaves it
+            if (!chunks[lane] || local.x < 0 || local.y < 0 || local.z < 0
+                || local.x >= m_chunk_size.x || local.y >= m_chunk_size.y
+                || local.z >= m_chunk_size.z) {
+                const glm::i32vec3 chunk_coords = toChunkCoords(voxel_coords);
+                chunks[lane] = findChunk(chunk_coords);
+                if (!chunks[lane]) {
+                    finish(lane, nullptr);
+                    continue;
+                }
+                chunk_origins[lane] = chunk_coords * m_chunk_size;
+                local = voxel_coords - chunk_origins[lane];
+            }
+
+            // Empty chunks and bricks are crossed in one jump
+            const Chunk *chunk = chunks[lane];
+            const ChunkOccupancy &occupancy = chunk->getOccupancy();
+            const glm::i32vec3 chunk_max = chunk_origins[lane] + m_chunk_size;
+            if (occupancy.isEmpty()
+                || (chunk->isUniform() && !m_block_registry.isSolid(chunk->getUniformVoxel().id))) {
+                jump(lane, chunk_origins[lane], chunk_max);
+                continue;
+            }
+
+            const glm::i32vec3 brick = local >> ChunkOccupancy::BRICK_SHIFT;
+            if (occupancy.isBrickEmpty(brick)) {
+                const glm::i32vec3 brick_min = chunk_origins[lane]
+                                               + (brick << ChunkOccupancy::BRICK_SHIFT);
+                jump(lane, brick_min, glm::min(brick_min + ChunkOccupancy::BRICK_SIZE, chunk_max));
+                continue;
+            }
+
+            if (occupancy.isSolid(local))
+                finish(lane, &chunk->getVoxels().get(chunk->voxelCoordsToIndex(local)));
+        }
+
+        // Branchless DDA step of every lane that did not jump, finished lanes
+        // step harmlessly
+        for (int32_t lane = 0; lane < N; ++lane) {
+            const bool move = !jumped[lane];
+            const bool x_first = t_max[0][lane] < t_max[1][lane] && t_max[0][lane] < t_max[2][lane];
+            const bool y_first = !x_first && t_max[1][lane] < t_max[2][lane];
+            const bool step_x = move && x_first;
+            const bool step_y = move && y_first;
+            const bool step_z = move && !x_first && !y_first;
+
+            t[lane] = step_x ? t_max[0][lane]
+                             : (step_y ? t_max[1][lane] : (step_z ? t_max[2][lane] : t[lane]));
+            axis[lane] = step_x ? 0 : (step_y ? 1 : (step_z ? 2 : axis[lane]));
+
+            position[0][lane] += step_x ? step[0][lane] : 0;
+            position[1][lane] += step_y ? step[1][lane] : 0;
+            position[2][lane] += step_z ? step[2][lane] : 0;
+
+            t_max[0][lane] += step_x ? t_delta[0][lane] : 0.0f;
+            t_max[1][lane] += step_y ? t_delta[1][lane] : 0.0f;
+            t_max[2][lane] += step_z ? t_delta[2][lane] : 0.0f;
+        }
+
+        for (int32_t lane = 0; lane < N; ++lane)
+            if (active[lane] && t[lane] > max_t[lane])
+                finish(lane, nullptr);
     }
+}
 
-    if (local_voxel_coords.y == 0 && containsChunk(chunk_coords + glm::i32vec3{0, -1, 0})) {
-        m_chunk_states[chunkCoordsToIndex(chunk_coords + glm::i32vec3{0, -1, 0})]->chunk->m_modified
-            = true;
-        m_chunks_modfied = true;
+int32_t Chunks::getHeight(const glm::i32vec2 &column) const
+{
+    glm::i32vec3 chunk_coords = toChunkCoords({column.x, 0, column.y});
+    const glm::i32vec3 local_coords = toLocalCoords({column.x, 0, column.y});
+    for (chunk_coords.y = m_chunks_size.y - 1; chunk_coords.y >= 0; --chunk_coords.y) {
+        const Chunk *chunk = findChunk(chunk_coords);
+        if (!chunk)
+            continue;
+
+        const int32_t height = chunk->getOccupancy().getColumnHeight(local_coords.x,
+                                                                      local_coords.z);
+        if (height > 0)
+            return chunk_coords.y * m_chunk_size.y + height;
     }
+    return 0;
+}
 
-    if (local_voxel_coords.y == (m_chunk_size.y - 1)
-        && containsChunk(chunk_coords + glm::i32vec3{0, 1, 0})) {
-        m_chunk_states[chunkCoordsToIndex(chunk_coords + glm::i32vec3{0, 1, 0})]->chunk->m_modified
-            = true;
-        m_chunks_modfied = true;
+ChunkSnapshot Chunks::takeSnapshot(const glm::i32vec3 &chunk_coords) const
+{
+    ChunkSnapshot snapshot{chunk_coords, m_chunk_size};
+    const Chunk *chunk = findChunk(chunk_coords);
+    if (!chunk)
+        return snapshot;
+
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x) {
+                if (const Chunk *neighbour = chunk->getNeighbour(offset))
+                    snapshot.m_entries[ChunkSnapshot::offsetToIndex(offset)]
+                        = neighbour->getSnapshotEntry();
+            }
+        }
     }
+    return snapshot;
+}
 
-    if (local_voxel_coords.z == 0 && containsChunk(chunk_coords + glm::i32vec3{0, 0, -1})) {
-        m_chunk_states[chunkCoordsToIndex(chunk_coords + glm::i32vec3{0, 0, -1})]->chunk->m_modified
-            = true;
-        m_chunks_modfied = true;
+bool Chunks::isSnapshotCurrent(const ChunkSnapshot &snapshot) const
+{
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x) {
+                const Chunk *chunk = findChunk(snapshot.getChunkCoords() + offset);
+                if ((chunk ? chunk->getVersion() : 0) != snapshot.getEntry(offset).version)
+                    return false;
+            }
+        }
     }
+    return true;
+}
+
+void Chunks::setPhysicsWorld(reactphysics3d::PhysicsCommon *physics_common,
+                             reactphysics3d::PhysicsWorld *physics_world)
+{
+    m_colliders.reset();
+    if (!physics_common || !physics_world)
+        return;
+
+    m_colliders = std::make_unique<ChunkColliders>(this, physics_common, physics_world);
+    m_chunk_states.forEach(
+        [this](const glm::i32vec3 &, const PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state == ChunkState::GENERATED)
+                m_colliders->update(chunk_state->chunk.get());
+        });
+}
 
-    if (local_voxel_coords.z == (m_chunk_size.z - 1)
-        && containsChunk(chunk_coords + glm::i32vec3{0, 0, 1})) {
-        m_chunk_states[chunkCoordsToIndex(chunk_coords + glm::i32vec3{0, 0, 1})]->chunk->m_modified
-            = true;
-        m_chunks_modfied = true;
+ChunkColliders *Chunks::getColliders() const
+{
+    return m_colliders.get();
+}
+
+Chunks::ChunkMemoryUsage Chunks::getChunkMemoryUsage(const glm::i32vec3 &chunk_coords) const
+{
+    ChunkMemoryUsage usage;
+    const auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (!chunk_state || (*chunk_state)->state != ChunkState::GENERATED)
+        return usage;
+
+    const Chunk *chunk = (*chunk_state)->chunk.get();
+    usage.summaries_bytes = chunk->getOccupancy().getMemoryUsage();
+    if (chunk->hasLod())
+        usage.summaries_bytes += chunk->getLod().getMemoryUsage();
+    usage.mesh_cpu_bytes = (*chunk_state)->mesh->getCpuMemoryUsage();
+    usage.mesh_gpu_bytes = (*chunk_state)->mesh->getGpuMemoryUsage();
+    usage.empty = chunk->getOccupancy().isEmpty();
+    if (chunk->isDormant()) {
+        usage.voxels_bytes = chunk->getDormantMemoryUsage();
+        usage.dormant = true;
+        return usage;
     }
 
-    m_chunk_states[chunkCoordsToIndex(chunk_coords)]->chunk->setVoxel(voxel_coords % m_chunk_size,
-                                                                      voxel);
+    usage.voxels_bytes = chunk->getVoxels().getMemoryUsage();
+    usage.light_bytes = chunk->getLightmap().getMemoryUsage();
+    usage.uniform = chunk->isUniform();
+    return usage;
 }
 
-void Chunks::setVoxelByGlobal(const glm::vec3 &global_coords, const Voxel &voxel)
+Chunks::MemoryUsage Chunks::getMemoryUsage() const
 {
-    setVoxel(static_cast<glm::i32vec3>(global_coords / m_voxel_size), voxel);
+    MemoryUsage usage;
+    m_chunk_states.forEach(
+        [this, &usage](const glm::i32vec3 &chunk_coords, const PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state != ChunkState::GENERATED)
+                return;
+
+            const ChunkMemoryUsage chunk_usage = getChunkMemoryUsage(chunk_coords);
+            ++usage.chunks_count;
+            usage.uniform_chunks_count += chunk_usage.uniform;
+            usage.empty_chunks_count += chunk_usage.empty;
+            usage.dormant_chunks_count += chunk_usage.dormant;
+            usage.voxels_bytes += chunk_usage.voxels_bytes;
+            usage.light_bytes += chunk_usage.light_bytes;
+            usage.summaries_bytes += chunk_usage.summaries_bytes;
+            usage.mesh_cpu_bytes += chunk_usage.mesh_cpu_bytes;
+            usage.mesh_gpu_bytes += chunk_usage.mesh_gpu_bytes;
+        });
+    usage.pool = MemoryPool::getInstance().getStats();
+    usage.noise_cache = m_noise_cache.getStats();
+    return usage;
 }
 
-uint8_t Chunks::getLight(const glm::i32vec3 &voxel_coords, int32_t channel) const
+void Chunks::logMemoryUsage() const
 {
-    if (!containsVoxel(voxel_coords))
-        return 0;
+    const MemoryUsage usage = getMemoryUsage();
+    spdlog::info("Chunks memory: {} chunks ({} uniform, {} empty, {} dormant), voxels {} KiB, "
+                 "light {} KiB, summaries {} KiB, mesh cpu {} KiB, mesh gpu {} KiB",
+                 usage.chunks_count,
+                 usage.uniform_chunks_count,
+                 usage.empty_chunks_count,
+                 usage.dormant_chunks_count,
+                 usage.voxels_bytes / 1024,
+                 usage.light_bytes / 1024,
+                 usage.summaries_bytes / 1024,
+                 usage.mesh_cpu_bytes / 1024,
+                 usage.mesh_gpu_bytes / 1024);
+    spdlog::info("Chunks memory pool: {} slabs ({} KiB), {} KiB used, {} KiB free",
+                 usage.pool.slabs_count,
+                 usage.pool.slabs_bytes / 1024,
+                 usage.pool.used_bytes / 1024,
+                 usage.pool.free_bytes / 1024);
+    spdlog::info("Chunks noise cache: {} columns ({} KiB), {} hits, {} misses, {} samples",
+                 usage.noise_cache.columns_count,
+                 usage.noise_cache.memory_bytes / 1024,
+                 usage.noise_cache.hits_count,
+                 usage.noise_cache.misses_count,
+                 usage.noise_cache.samples_count);
+
+    if (m_dormancy_delay == Time{})
+        return;
 
-    return m_chunk_states[chunkCoordsToIndex(voxel_coords / m_chunk_size)]
-        ->chunk->getLightmap()
-        .get(voxel_coords % m_chunk_size, channel);
+    const DormancyStats stats = getDormancyStats();
+    spdlog::info("Chunks dormancy: {} chunks, {} KiB compressed to {} KiB ({:.1f}x), {} "
+                 "decompressions, {:.1f} us average, {} us max",
+                 stats.dormant_chunks_count,
+                 stats.raw_bytes / 1024,
+                 stats.compressed_bytes / 1024,
+                 stats.compressed_bytes > 0
+                     ? static_cast<double>(stats.raw_bytes) / stats.compressed_bytes
+                     : 0.0,
+                 stats.decompressions_count,
+                 stats.decompressions_count > 0
+                     ? static_cast<double>(stats.decompress_time.asMicroseconds())
+                           / stats.decompressions_count
+                     : 0.0,
+                 stats.max_decompress_time.asMicroseconds());
 }
 
-bool Chunks::isVoxelBlocked(const glm::i32vec3 &voxel_coords) const
+const Time &Chunks::getMemoryLogInterval() const
 {
-    auto *voxel = getVoxel(voxel_coords);
-    return !voxel ? false : voxel->id != 0;
+    return m_memory_log_interval;
 }
 
-bool Chunks::containsChunk(const glm::i32vec3 &chunk_coords) const
+void Chunks::setMemoryLogInterval(const Time &interval)
 {
-    return chunk_coords.x >= 0 && chunk_coords.x < m_chunks_size.x && chunk_coords.y >= 0
-           && chunk_coords.y < m_chunks_size.y && chunk_coords.z >= 0
-           && chunk_coords.z < m_chunks_size.z;
+    m_memory_log_interval = interval;
+    m_memory_log_clock.restart();
 }
 
-bool Chunks::containsVoxel(const glm::i32vec3 &voxel_coords) const
+const Time &Chunks::getDormancyDelay() const
 {
-    return voxel_coords.x >= 0 && voxel_coords.x < (m_chunk_size.x * m_chunks_size.x)
-           && voxel_coords.y >= 0 && voxel_coords.y < (m_chunk_size.y * m_chunks_size.y)
-           && voxel_coords.z >= 0 && voxel_coords.z < (m_chunk_size.z * m_chunks_size.z);
+    return m_dormancy_delay;
 }
 
-const Voxel *Chunks::rayCast(glm::vec3 start,
-                             glm::vec3 direction,
-                             float max_dist,
-                             glm::vec3 &end,
-                             glm::vec3 &norm,
-                             glm::vec3 &iend)
+void Chunks::setDormancyDelay(const Time &delay)
 {
-    float px = start.x;
-    float py = start.y;
-    float pz = start.z;
+    m_dormancy_delay = delay;
+}
 
-    float dx = direction.x;
-    float dy = direction.y;
-    float dz = direction.z;
+Chunks::DormancyStats Chunks::getDormancyStats() const
+{
+    DormancyStats stats;
+    m_chunk_states.forEach(
+        [&stats](const glm::i32vec3 &, const PoolPtr<ChunkState> &chunk_state) {
+            const Chunk *chunk = chunk_state->chunk.get();
+            if (chunk_state->state != ChunkState::GENERATED || !chunk->isDormant())
+                return;
+
+            ++stats.dormant_chunks_count;
+            stats.raw_bytes += chunk->m_dormant_raw_size;
+            stats.compressed_bytes += chunk->getDormantMemoryUsage();
+        });
+    stats.compressions_count = m_compressions_count;
+    stats.decompressions_count = m_decompressions_count.load(std::memory_order_relaxed);
+    stats.decompress_time = microseconds(m_decompress_time.load(std::memory_order_relaxed));
+    stats.max_decompress_time = microseconds(
+        m_max_decompress_time.load(std::memory_order_relaxed));
+    return stats;
+}
 
-    float t = 0.0f;
-    int32_t ix = std::floor(px);
-    int32_t iy = std::floor(py);
-    int32_t iz = std::floor(pz);
+void Chunks::update()
+{
+    m_update_time = Clock::getCurrentTime();
 
-    float step_x = (dx > 0.0f) ? 1.0f : -1.0f;
-    float step_y = (dy > 0.0f) ? 1.0f : -1.0f;
-    float step_z = (dz > 0.0f) ? 1.0f : -1.0f;
+    if (m_block_registry_version != m_block_registry.getVersion())
+        updateBlockRegistry();
 
-    float infinity = std::numeric_limits<float>::infinity();
+    if (m_streaming)
+        updateStreaming();
 
-    float tx_delta = (dx == 0.0f) ? infinity : std::abs(1.0f / dx);
-    float ty_delta = (dy == 0.0f) ? infinity : std::abs(1.0f / dy);
-    float tz_delta = (dz == 0.0f) ? infinity : std::abs(1.0f / dz);
+    loadChunks();
+    scheduleStages();
+    finishGeneratedChunks();
 
-    float x_dist = (step_x > 0) ? (ix + 1 - px) : (px - ix);
-    float y_dist = (step_y > 0) ? (iy + 1 - py) : (py - iy);
-    float z_dist = (step_z > 0) ? (iz + 1 - pz) : (pz - iz);
+    if (m_storage && m_save_interval > Time{}
+        && m_save_clock.getElapsedTime() >= m_save_interval) {
+        m_save_clock.restart();
+        save();
+    }
 
-    float tx_max = (tx_delta < infinity) ? tx_delta * x_dist : infinity;
-    float ty_max = (ty_delta < infinity) ? ty_delta * y_dist : infinity;
-    float tz_max = (tz_delta < infinity) ? tz_delta * z_dist : infinity;
+    if (m_memory_log_interval > Time{}
+        && m_memory_log_clock.getElapsedTime() >= m_memory_log_interval) {
+        m_memory_log_clock.restart();
+        logMemoryUsage();
+    }
+
+    if (m_dormancy_delay > Time{} && m_dormancy_clock.getElapsedTime() >= seconds(1.0f)) {
+        m_dormancy_clock.restart();
+        compressDormantChunks();
+    }
+
+    if (m_chunks_modfied) {
+        m_chunks_modfied = false;
+        m_chunk_states.forEach(
+            [this](const glm::i32vec3 &chunk_coords, PoolPtr<ChunkState> &chunk_state) {
+                if (chunk_state->state == ChunkState::GENERATED
+                    && chunk_state->chunk->m_modified == true) {
+                    chunk_state->chunk->m_modified = false;
+                    chunk_state->chunk->collapseLightmap();
+                    chunk_state->mesh->create(this, chunk_coords);
+                    if (m_colliders)
+                        m_colliders->update(chunk_state->chunk.get());
+                }
+            });
+    }
+}
+
+void Chunks::draw(const RenderTarget &render_target) const
+{
+    // for (const auto &chunk_state : m_chunk_states)
+    //     render_target.draw(*chunk_state->mesh);
+}
 
-    int32_t stepped_index = -1;
-    max_dist *= m_voxel_size;
+void Chunks::markChunkModified(const glm::i32vec3 &chunk_coords)
+{
+    Chunk *chunk = findChunk(chunk_coords);
+    if (!chunk)
+        return;
 
-    while (t <= max_dist) {
-        auto *voxel = getVoxelByGlobal(glm::vec3{ix, iy, iz});
+    chunk->m_modified = true;
+    m_chunks_modfied = true;
+}
 
-        if (voxel == nullptr || voxel->id != 0) {
-            end.x = px + t * dx;
-            end.y = py + t * dy;
-            end.z = pz + t * dz;
+void Chunks::markChunkEdited(const glm::i32vec3 &chunk_coords,
+                             const glm::i32vec3 &changed_min,
+                             const glm::i32vec3 &changed_max)
+{
+    Chunk *chunk = findChunk(chunk_coords);
+    chunk->m_unsaved = true;
+    markChunkModified(chunk_coords);
 
-            iend.x = ix;
-            iend.y = iy;
-            iend.z = iz;
+    if (changed_min.x == 0)
+        markChunkModified(chunk_coords + glm::i32vec3{-1, 0, 0});
 
-            norm.x = norm.y = norm.z = 0.0f;
-            if (stepped_index == 0)
-                norm.x = -step_x;
-            if (stepped_index == 1)
-                norm.y = -step_y;
-            if (stepped_index == 2)
-                norm.z = -step_z;
-            return voxel;
-        }
+    if (changed_max.x == (m_chunk_size.x - 1))
+        markChunkModified(chunk_coords + glm::i32vec3{1, 0, 0});
+
+    if (changed_min.y == 0)
+        markChunkModified(chunk_coords + glm::i32vec3{0, -1, 0});
+
+    if (changed_max.y == (m_chunk_size.y - 1))
+        markChunkModified(chunk_coords + glm::i32vec3{0, 1, 0});
+
+    if (changed_min.z == 0)
+        markChunkModified(chunk_coords + glm::i32vec3{0, 0, -1});
+
+    if (changed_max.z == (m_chunk_size.z - 1))
+        markChunkModified(chunk_coords + glm::i32vec3{0, 0, 1});
+}
+
+template<typename Func>
+int32_t Chunks::editChunks(const glm::i32vec3 &min_voxel,
+                           const glm::i32vec3 &max_voxel,
+                           Func &&func)
+{
+    if (max_voxel.x < min_voxel.x || max_voxel.y < min_voxel.y || max_voxel.z < min_voxel.z)
+        return 0;
 
-        if (tx_max < ty_max) {
-            if (tx_max < tz_max) {
-                ix += step_x;
-                t = tx_max;
-                tx_max += tx_delta;
-                stepped_index = 0;
-            } else {
-                iz += step_z;
-                t = tz_max;
-                tz_max += tz_delta;
-                stepped_index = 2;
+    const glm::i32vec3 min_chunk = toChunkCoords(min_voxel);
+    const glm::i32vec3 max_chunk = toChunkCoords(max_voxel);
+
+    int32_t changed_count = 0;
+    glm::i32vec3 chunk_coords;
+    for (chunk_coords.y = min_chunk.y; chunk_coords.y <= max_chunk.y; ++chunk_coords.y) {
+        for (chunk_coords.z = min_chunk.z; chunk_coords.z <= max_chunk.z; ++chunk_coords.z) {
+            for (chunk_coords.x = min_chunk.x; chunk_coords.x <= max_chunk.x; ++chunk_coords.x) {
+                Chunk *chunk = findChunk(chunk_coords);
+                if (!chunk)
+                    continue;
+
+                const glm::i32vec3 offset = chunk_coords * m_chunk_size;
+                const glm::i32vec3 local_min = glm::max(min_voxel - offset, glm::i32vec3{0});
+                const glm::i32vec3 local_max = glm::min(max_voxel - offset, m_chunk_size - 1);
+
+                glm::i32vec3 changed_min{m_chunk_size};
+                glm::i32vec3 changed_max{-1};
+                const int32_t chunk_changed_count = func(chunk,
+                                                         local_min,
+                                                         local_max,
+                                                         changed_min,
+                                                         changed_max);
+                if (chunk_changed_count == 0)
+                    continue;
+
+                changed_count += chunk_changed_count;
+                markChunkEdited(chunk_coords, changed_min, changed_max);
             }
-        } else {
-            if (ty_max < tz_max) {
-                iy += step_y;
-                t = ty_max;
-                ty_max += ty_delta;
-                stepped_index = 1;
-            } else {
-                iz += step_z;
-                t = tz_max;
-                tz_max += tz_delta;
-                stepped_index = 2;
+        }
+    }
+
+    return changed_count;
+}
+
+template<typename Func>
+int32_t Chunks::editVoxels(Chunk *chunk,
+                           const glm::i32vec3 &local_min,
+                           const glm::i32vec3 &local_max,
+                           Func &&func,
+                           glm::i32vec3 &changed_min,
+                           glm::i32vec3 &changed_max)
+{
+    const glm::i32vec3 offset = chunk->getPosition() * m_chunk_size;
+    // Voxels are only taken for writing once something changes
+    const VoxelStorage *voxels = &chunk->getVoxels();
+    VoxelStorage *mutable_voxels = nullptr;
+
+    int32_t changed_count = 0;
+    glm::i32vec3 local;
+    for (local.y = local_min.y; local.y <= local_max.y; ++local.y) {
+        for (local.z = local_min.z; local.z <= local_max.z; ++local.z) {
+            int32_t index = chunk->voxelCoordsToIndex({local_min.x, local.y, local.z});
+            for (local.x = local_min.x; local.x <= local_max.x; ++local.x, ++index) {
+                const Voxel old_voxel = voxels->get(index);
+                Voxel voxel = old_voxel;
+                if (!func(offset + local, voxel) || voxel.id == old_voxel.id)
+                    continue;
+
+                if (!mutable_voxels)
+                    voxels = mutable_voxels = &chunk->getMutableVoxels();
+                mutable_voxels->set(index, voxel);
+                journalEdit(chunk, index, voxel);
+                chunk->updateSummaries(local, old_voxel, voxel);
+                changed_min = glm::min(changed_min, local);
+                changed_max = glm::max(changed_max, local);
+                ++changed_count;
             }
         }
     }
 
-    iend.x = ix;
-    iend.y = iy;
-    iend.z = iz;
+    return changed_count;
+}
 
-    end.x = px + t * dx;
-    end.y = py + t * dy;
-    end.z = pz + t * dz;
-    norm.x = norm.y = norm.z = 0.0f;
+void Chunks::loadChunk(const glm::i32vec3 &chunk_coords, int32_t target_stage)
+{
+    auto chunk_state = makePooled<ChunkState>(chunk_coords,
+                                              this,
+                                              m_atlas_texture,
+                                              getEngine());
+    chunk_state->mesh->setPosition(static_cast<glm::vec3>(chunk_coords)
+                                   * static_cast<glm::vec3>(m_chunk_size) * m_voxel_size);
+    // The state is owned by a pointer, it stays in place when the map grows
+    ChunkState &state = *chunk_state;
+    Chunk *chunk = chunk_state->chunk.get();
+    m_chunk_states.insert(chunk_coords, std::move(chunk_state));
+
+    if (m_storage && m_storage->loadChunk(chunk)) {
+        if (m_lod_enabled)
+            chunk->getLod();
+        // Neighbour stages read saved chunks as they are
+        state.stage = GENERATION_STAGES_COUNT;
+        state.target_stage = GENERATION_STAGES_COUNT;
+        state.stage_entries.fill(chunk->getSnapshotEntry());
+        finishChunk(chunk_coords);
+        queueStageNeighbours(chunk_coords);
+        return;
+    }
 
-    return nullptr;
+    state.target_stage = target_stage;
+    m_stage_queue.push_back(chunk_coords);
 }
 
-void Chunks::forEachVoxels(
-    const std::function<void(const glm::i32vec3 &, const glm::i32vec3 &)> &func) const
+void Chunks::unloadChunk(const glm::i32vec3 &chunk_coords)
 {
-    if (!func)
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (!chunk_state)
+        return;
+
+    // Chunks running a stage are unloaded once it is finished
+    if ((*chunk_state)->stage_running)
         return;
 
-    glm::i32vec3 voxel_coords{0};
-    for (voxel_coords.y = 0; voxel_coords.y < m_chunk_size.y * m_chunks_size.y; ++voxel_coords.y) {
-        for (voxel_coords.z = 0; voxel_coords.z < m_chunk_size.z * m_chunks_size.z;
-             ++voxel_coords.z) {
-            for (voxel_coords.x = 0; voxel_coords.x < m_chunk_size.x * m_chunks_size.x;
-                 ++voxel_coords.x) {
-                func(voxel_coords % m_chunk_size, voxel_coords);
+    // Chunks that failed to save stay loaded, save() retries them and keeps
+    // the journal uncompacted until they are saved, a later pass unloads them
+    Chunk *chunk = (*chunk_state)->chunk.get();
+    if ((*chunk_state)->state == ChunkState::GENERATED && m_storage && chunk->isUnsaved()
+        && !m_storage->saveChunk(chunk)) {
+        spdlog::error("Failed to save chunk {} {} {}, kept loaded",
+                      chunk_coords.x,
+                      chunk_coords.y,
+                      chunk_coords.z);
+        return;
+    }
+
+    // Neighbours waiting for this chunk are queued again when their target is raised
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x) {
+                if (auto *neighbour = m_chunk_states.find(chunk_coords + offset))
+                    (*neighbour)->target_stage = (*neighbour)->stage;
+            }
+        }
+    }
+
+    if ((*chunk_state)->state != ChunkState::GENERATED) {
+        m_chunk_states.remove(chunk_coords);
+        return;
+    }
+
+    unlinkChunk(chunk);
+    if (m_colliders)
+        m_colliders->remove(chunk_coords);
+    m_chunk_states.remove(chunk_coords);
+
+    for (const auto &offset : {glm::i32vec3{-1, 0, 0},
+                               glm::i32vec3{1, 0, 0},
+                               glm::i32vec3{0, -1, 0},
+                               glm::i32vec3{0, 1, 0},
+                               glm::i32vec3{0, 0, -1},
+                               glm::i32vec3{0, 0, 1}})
+        markChunkModified(chunk_coords + offset);
+}
+
+bool Chunks::isInRadius(const glm::i32vec3 &chunk_coords, int32_t radius) const
+{
+    int32_t dx = chunk_coords.x - m_focus_chunk.x;
+    int32_t dz = chunk_coords.z - m_focus_chunk.z;
+    return dx * dx + dz * dz <= radius * radius;
+}
+
+bool Chunks::isInUnloadRadius(const glm::i32vec3 &chunk_coords) const
+{
+    // Every stage needs the neighbours one stage behind, so the chunks in view
+    // need partially generated chunks up to a stage count of chunks further out
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (chunk_state && (*chunk_state)->state != ChunkState::GENERATED)
+        return isInRadius(chunk_coords, m_unload_radius + 2 * GENERATION_STAGES_COUNT);
+    return isInRadius(chunk_coords, m_unload_radius);
+}
+
+bool Chunks::isInWorld(const glm::i32vec3 &chunk_coords) const
+{
+    if (chunk_coords.y < 0 || chunk_coords.y >= m_chunks_size.y)
+        return false;
+    return m_streaming
+           || (chunk_coords.x >= 0 && chunk_coords.x < m_chunks_size.x && chunk_coords.z >= 0
+               && chunk_coords.z < m_chunks_size.z);
+}
+
+void Chunks::updateStreaming()
+{
+    if (m_focus_changed) {
+        m_focus_changed = false;
+
+        std::vector<glm::i32vec3> unload_chunks;
+        m_chunk_states.forEach(
+            [this, &unload_chunks](const glm::i32vec3 &chunk_coords,
+                                   const PoolPtr<ChunkState> &) {
+                if (!isInUnloadRadius(chunk_coords))
+                    unload_chunks.push_back(chunk_coords);
+            });
+
+        for (const auto &chunk_coords : unload_chunks)
+            unloadChunk(chunk_coords);
+
+        m_load_queue.clear();
+        glm::i32vec3 chunk_coords;
+        for (chunk_coords.z = m_focus_chunk.z - m_view_radius;
+             chunk_coords.z <= m_focus_chunk.z + m_view_radius;
+             ++chunk_coords.z) {
+            for (chunk_coords.x = m_focus_chunk.x - m_view_radius;
+                 chunk_coords.x <= m_focus_chunk.x + m_view_radius;
+                 ++chunk_coords.x) {
+                if (!isInRadius(chunk_coords, m_view_radius))
+                    continue;
+                for (chunk_coords.y = 0; chunk_coords.y < m_chunks_size.y; ++chunk_coords.y) {
+                    if (!findChunk(chunk_coords))
+                        m_load_queue.push_back(chunk_coords);
+                }
             }
         }
+
+        // Nearest chunks are at the back of the queue, columns at the same
+        // distance stay apart so stacked chunks share their noise column
+        std::sort(m_load_queue.begin(),
+                  m_load_queue.end(),
+                  [this](const glm::i32vec3 &left, const glm::i32vec3 &right) {
+                      glm::i32vec3 l = left - m_focus_chunk;
+                      glm::i32vec3 r = right - m_focus_chunk;
+                      const int32_t l_dist = l.x * l.x + l.z * l.z;
+                      const int32_t r_dist = r.x * r.x + r.z * r.z;
+                      if (l_dist != r_dist)
+                          return l_dist > r_dist;
+                      if (left.x != right.x)
+                          return left.x < right.x;
+                      if (left.z != right.z)
+                          return left.z < right.z;
+                      return left.y > right.y;
+                  });
+    }
+}
+
+void Chunks::loadChunks()
+{
+    // Streaming worlds spread loads over frames, fixed worlds queue everything at once
+    int32_t max_chunk_loads = m_streaming ? m_max_chunk_loads : m_load_queue.size();
+
+    for (int32_t i = 0; i < max_chunk_loads && !m_load_queue.empty(); ++i) {
+        glm::i32vec3 chunk_coords = m_load_queue.back();
+        m_load_queue.pop_back();
+        if (m_chunk_states.contains(chunk_coords))
+            raiseTargetStage(chunk_coords, GENERATION_STAGES_COUNT);
+        else
+            loadChunk(chunk_coords, GENERATION_STAGES_COUNT);
     }
 }
 
-void Chunks::forEachVoxelsInChunk(
-    const glm::i32vec3 &chunk_coords,
-    const std::function<void(const glm::i32vec3 &, const glm::i32vec3 &)> &func) const
+void Chunks::finishGeneratedChunks()
 {
-    if (!containsChunk(chunk_coords) || !func)
+    // Both lists keep their capacity, swapping them does not allocate
+    std::vector<glm::i32vec3> &generated_chunks = m_finished_chunks;
+    generated_chunks.clear();
+    {
+        std::lock_guard<std::mutex> lock{m_generated_mutex};
+        std::swap(generated_chunks, m_generated_chunks);
+    }
+
+    if (generated_chunks.empty())
         return;
 
-    glm::i32vec3 voxel_offsets = chunk_coords * m_chunk_size;
-    glm::i32vec3 voxel_coords{0};
-    for (voxel_coords.y = 0; voxel_coords.y < m_chunk_size.y; ++voxel_coords.y) {
-        for (voxel_coords.z = 0; voxel_coords.z < m_chunk_size.z; ++voxel_coords.z) {
-            for (voxel_coords.x = 0; voxel_coords.x < m_chunk_size.x; ++voxel_coords.x) {
-                func(voxel_coords, voxel_offsets + voxel_coords);
+    m_generating_chunks -= generated_chunks.size();
+
+    for (const auto &chunk_coords : generated_chunks) {
+        finishStage(chunk_coords);
+        if (m_streaming && !isInUnloadRadius(chunk_coords))
+            unloadChunk(chunk_coords);
+    }
+    scheduleStages();
+
+    if (!m_streaming && m_generating_chunks == 0 && m_load_queue.empty()) {
+        size_t voxels_memory = 0;
+        m_chunk_states.forEach(
+            [&voxels_memory](const glm::i32vec3 &, const PoolPtr<ChunkState> &chunk_state) {
+                voxels_memory += chunk_state->chunk->getVoxels().getMemoryUsage();
+            });
+
+        spdlog::debug("Chunks voxels memory: {} bytes (flat layout: {} bytes)",
+                      voxels_memory,
+                      m_chunk_states.getSize() * m_chunk_size.x * m_chunk_size.y * m_chunk_size.z
+                          * sizeof(Voxel));
+    }
+}
+
+void Chunks::finishChunk(const glm::i32vec3 &chunk_coords)
+{
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (!chunk_state)
+        return;
+
+    (*chunk_state)->state = ChunkState::GENERATED;
+
+    // Block types may change while the chunk is generated
+    Chunk *chunk = (*chunk_state)->chunk.get();
+    if (auto *journal_edits = m_journal_edits.find(chunk_coords)) {
+        applyJournalEdits(chunk, *journal_edits);
+        m_journal_edits.remove(chunk_coords);
+    } else if (chunk->getOccupancy().getBlockRegistryVersion() != m_block_registry.getVersion()) {
+        chunk->rebuildSummaries();
+    }
+    linkChunk(chunk);
+    chunk->touch(m_update_time);
+
+    markChunkModified(chunk_coords);
+    for (const auto &offset : {glm::i32vec3{-1, 0, 0},
+                               glm::i32vec3{1, 0, 0},
+                               glm::i32vec3{0, -1, 0},
+                               glm::i32vec3{0, 1, 0},
+                               glm::i32vec3{0, 0, -1},
+                               glm::i32vec3{0, 0, 1}})
+        markChunkModified(chunk_coords + offset);
+
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x)
+                releaseStageEntries(chunk_coords + offset);
+        }
+    }
+}
+
+void Chunks::finishStage(const glm::i32vec3 &chunk_coords)
+{
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (!chunk_state)
+        return;
+
+    ChunkState &state = **chunk_state;
+    state.stage_running = false;
+    state.stage_entries[state.stage] = state.chunk->getSnapshotEntry();
+    ++state.stage;
+    if (state.stage == GENERATION_STAGES_COUNT)
+        finishChunk(chunk_coords);
+    queueStageNeighbours(chunk_coords);
+}
+
+void Chunks::scheduleStages()
+{
+    // Scheduling queues more chunks, they are handled in the same pass
+    for (size_t i = 0; i < m_stage_queue.size(); ++i) {
+        const glm::i32vec3 chunk_coords = m_stage_queue[i];
+        scheduleStage(chunk_coords);
+    }
+    m_stage_queue.clear();
+}
+
+void Chunks::scheduleStage(const glm::i32vec3 &chunk_coords)
+{
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (!chunk_state)
+        return;
+
+    // Loading neighbours may grow the map, the state itself stays in place
+    ChunkState &state = **chunk_state;
+    if (state.stage_running)
+        return;
+
+    // Stages without a function keep the data of the previous stage
+    while (state.stage < state.target_stage && !m_generation_stages[state.stage])
+        finishStage(chunk_coords);
+    if (state.stage >= state.target_stage)
+        return;
+
+    const int32_t stage = state.stage;
+    ChunkSnapshot neighbours{chunk_coords, m_chunk_size};
+    bool ready = true;
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x) {
+                const glm::i32vec3 neighbour_coords = chunk_coords + offset;
+                if (stage == 0 || offset == glm::i32vec3{0} || !isInWorld(neighbour_coords))
+                    continue;
+
+                auto *neighbour = m_chunk_states.find(neighbour_coords);
+                if (!neighbour) {
+                    // Targets left from an old focus would load chunks that are unloaded
+                    // again right away
+                    if (m_streaming
+                        && !isInRadius(neighbour_coords,
+                                       m_unload_radius + 2 * GENERATION_STAGES_COUNT)) {
+                        state.target_stage = stage;
+                        return;
+                    }
+                    loadChunk(neighbour_coords, stage);
+                    ready = false;
+                } else if ((*neighbour)->stage < stage) {
+                    raiseTargetStage(neighbour_coords, stage);
+                    ready = false;
+                } else {
+                    // Entries released before the stage got a function, the
+                    // chunk is read as it is like chunks loaded from storage
+                    const ChunkSnapshot::Entry &entry = (*neighbour)->stage_entries[stage - 1];
+                    neighbours.m_entries[ChunkSnapshot::offsetToIndex(offset)]
+                        = entry.voxels ? entry : (*neighbour)->chunk->getSnapshotEntry();
+                }
             }
         }
     }
+    if (!ready)
+        return;
+
+    Chunk *chunk = state.chunk.get();
+    neighbours.m_entries[ChunkSnapshot::offsetToIndex(glm::i32vec3{0})]
+        = chunk->getSnapshotEntry();
+
+    // Summaries are built once by the last stage that changes the chunk
+    bool last_stage = true;
+    for (int32_t i = stage + 1; i < GENERATION_STAGES_COUNT; ++i)
+        last_stage = last_stage && !m_generation_stages[i];
+
+    state.stage_running = true;
+    ++m_generating_chunks;
+    m_thread_pool.enqueue([this,
+                           chunk,
+                           chunk_coords,
+                           func = m_generation_stages[stage],
+                           neighbours = std::move(neighbours),
+                           seed = getChunkSeed(chunk_coords),
+                           last_stage,
+                           build_lod = m_lod_enabled]() {
+        func(chunk, neighbours, seed);
+        if (last_stage) {
+            // Stages may write storage directly
+            chunk->rebuildSummaries();
+            if (build_lod)
+                chunk->getLod();
+        }
+
+        std::lock_guard<std::mutex> lock{m_generated_mutex};
+        m_generated_chunks.push_back(chunk_coords);
+    });
 }
 
-void Chunks::update()
+void Chunks::raiseTargetStage(const glm::i32vec3 &chunk_coords, int32_t target_stage)
 {
-    if (m_chunks_modfied) {
-        m_chunks_modfied = false;
-        for (int32_t i = 0; i < m_chunk_states.size(); ++i) {
-            if (m_chunk_states[i]->chunk->m_modified == true) {
-                m_chunk_states[i]->chunk->m_modified = false;
-                m_chunk_states[i]->mesh->create(this, m_chunk_states[i]->chunk->getPosition());
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (!chunk_state)
+        return;
+
+    // Chunks already heading there are queued by their neighbours
+    if (target_stage <= (*chunk_state)->target_stage)
+        return;
+
+    (*chunk_state)->target_stage = target_stage;
+    m_stage_queue.push_back(chunk_coords);
+}
+
+void Chunks::queueStageNeighbours(const glm::i32vec3 &chunk_coords)
+{
+    // The chunk itself and the neighbours waiting for its stage
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x)
+                m_stage_queue.push_back(chunk_coords + offset);
+        }
+    }
+}
+
+void Chunks::releaseStageEntries(const glm::i32vec3 &chunk_coords)
+{
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    if (!chunk_state || (*chunk_state)->state != ChunkState::GENERATED)
+        return;
+
+    // Kept entries would copy the chunk data on its next edit
+    auto &stage_entries = (*chunk_state)->stage_entries;
+    if (m_streaming) {
+        for (int32_t stage = 0; stage < GENERATION_STAGES_COUNT; ++stage) {
+            if (!isStageEntryNeeded(stage))
+                stage_entries[stage] = {};
+        }
+        return;
+    }
+
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x) {
+                const glm::i32vec3 neighbour_coords = chunk_coords + offset;
+                if (isInWorld(neighbour_coords) && !findChunk(neighbour_coords))
+                    return;
             }
         }
     }
+    stage_entries.fill({});
 }
 
-void Chunks::draw(const RenderTarget &render_target) const
+bool Chunks::isStageEntryNeeded(int32_t stage) const
 {
-    // for (const auto &chunk_state : m_chunk_states)
-    //     render_target.draw(*chunk_state->mesh);
+    // Neighbours read it only when running the next stage
+    return stage + 1 < GENERATION_STAGES_COUNT && m_generation_stages[stage + 1];
+}
+
+void Chunks::loadJournal()
+{
+    if (!m_journal)
+        return;
+
+    const std::vector<EditJournal::Record> records = m_journal->read();
+    for (const auto &record : records) {
+        auto *edits = m_journal_edits.find(record.chunk_coords);
+        if (!edits)
+            edits = &m_journal_edits.insert(record.chunk_coords, {});
+        edits->push_back(record);
+    }
+
+    if (!records.empty())
+        spdlog::info("Edit journal: {} edits of {} chunks to replay",
+                     records.size(),
+                     m_journal_edits.getSize());
 }
 
-int32_t Chunks::chunkCoordsToIndex(const glm::i32vec3 &chunk_coords) const
+void Chunks::applyJournalEdits(Chunk *chunk, const std::vector<EditJournal::Record> &edits)
 {
-    return (chunk_coords.y * m_chunks_size.z + chunk_coords.z) * m_chunks_size.x + chunk_coords.x;
+    // Records are absolute, edits already in the saved chunk change nothing
+    VoxelStorage &voxels = chunk->getMutableVoxels();
+    for (const auto &edit : edits) {
+        if (edit.index == EditJournal::FILL_INDEX)
+            voxels.fill(edit.voxel);
+        else if (edit.index >= 0 && edit.index < voxels.getSize())
+            voxels.set(edit.index, edit.voxel);
+    }
+    chunk->rebuildSummaries();
+    chunk->m_unsaved = true;
 }
 
-void Chunks::setChunkData(const glm::i32vec3 &chunk_coords)
+int32_t Chunks::fillChunk(Chunk *chunk, const Voxel &voxel)
 {
-    forEachVoxelsInChunk(chunk_coords,
-                         [this](const glm::i32vec3 &voxel_coords_in_chunk,
-                                const glm::i32vec3 &voxel_coords) {
-                             int32_t real_x = voxel_coords.x * m_chunk_size.x;
-                             int32_t real_z = voxel_coords.z * m_chunk_size.z;
-                             int32_t real_y = voxel_coords.y * m_chunk_size.y;
+    const int32_t changed_count = chunk->fill(voxel);
+    if (changed_count > 0)
+        journalEdit(chunk, EditJournal::FILL_INDEX, voxel);
+    return changed_count;
+}
 
-                             // float height = (glm::perlin(
-                             //                     glm::vec2(real_x * 0.002625f, real_z * 0.00225f))
-                             //                 + 1.0f)
-                             //                * 0.6f;
+void Chunks::linkChunk(Chunk *chunk)
+{
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x) {
+                if (offset == glm::i32vec3{0})
+                    continue;
+
+                Chunk *neighbour = findChunk(chunk->getPosition() + offset);
+                chunk->m_neighbours[Chunk::neighbourToIndex(offset)] = neighbour;
+                if (neighbour)
+                    neighbour->m_neighbours[Chunk::neighbourToIndex(-offset)] = chunk;
+            }
+        }
+    }
+}
+
+void Chunks::unlinkChunk(Chunk *chunk)
+{
+    glm::i32vec3 offset;
+    for (offset.y = -1; offset.y <= 1; ++offset.y) {
+        for (offset.z = -1; offset.z <= 1; ++offset.z) {
+            for (offset.x = -1; offset.x <= 1; ++offset.x) {
+                Chunk *&neighbour = chunk->m_neighbours[Chunk::neighbourToIndex(offset)];
+                if (offset == glm::i32vec3{0} || !neighbour)
+                    continue;
+
+                neighbour->m_neighbours[Chunk::neighbourToIndex(-offset)] = nullptr;
+                neighbour = nullptr;
+            }
+        }
+    }
+}
 
-                             float height = (glm::perlin(glm::vec3{real_x * 0.005625f,
-                                                                   real_y * 0.009625f,
-                                                                   real_z * 0.00525f})
-                                             + 0.6f)
-                                            * 0.8f;
+void Chunks::updateBlockRegistry()
+{
+    m_block_registry_version = m_block_registry.getVersion();
+    m_chunk_states.forEach(
+        [this](const glm::i32vec3 &, const PoolPtr<ChunkState> &chunk_state) {
+            Chunk *chunk = chunk_state->chunk.get();
+            if (chunk_state->state != ChunkState::GENERATED
+                || chunk->getOccupancy().getBlockRegistryVersion() == m_block_registry_version)
+                return;
+
+            chunk->rebuildSummaries();
+            chunk->m_modified = true;
+            m_chunks_modfied = true;
+        });
+}
 
-                             int32_t id = (static_cast<float>(voxel_coords.y) / m_chunk_size.y)
-                                          < height;
+void Chunks::compressDormantChunks()
+{
+    const Time touch_threshold = m_update_time - m_dormancy_delay;
+    int32_t compressed_count = 0;
+    m_chunk_states.forEach(
+        [this, &touch_threshold, &compressed_count](const glm::i32vec3 &chunk_coords,
+                                                    const PoolPtr<ChunkState> &chunk_state) {
+            Chunk *chunk = chunk_state->chunk.get();
+            if (compressed_count == MAX_DORMANT_CHUNKS_PER_UPDATE
+                || chunk_state->state != ChunkState::GENERATED || chunk->m_modified
+                || chunk->getTouchTime() > touch_threshold
+                || (m_streaming && isInRadius(chunk_coords, m_view_radius)))
+                return;
+
+            if (chunk->compress(m_dormancy_buffer))
+                ++compressed_count;
+        });
+    m_compressions_count += compressed_count;
+}
 
-                             if (real_y <= 2)
-                                 id = 2;
+void Chunks::onChunkDecompressed(const Time &time)
+{
+    const int64_t time_us = time.asMicroseconds();
+    m_decompressions_count.fetch_add(1, std::memory_order_relaxed);
+    m_decompress_time.fetch_add(time_us, std::memory_order_relaxed);
+
+    int64_t max_time_us = m_max_decompress_time.load(std::memory_order_relaxed);
+    while (max_time_us < time_us
+           && !m_max_decompress_time.compare_exchange_weak(max_time_us,
+                                                           time_us,
+                                                           std::memory_order_relaxed)) {
+    }
+}
 
-                             setVoxel(voxel_coords, Voxel{id});
-                         });
+void Chunks::setChunkData(Chunk *chunk) const
+{
+    // Density is interpolated from the cached lattice of the chunk column
+    PoolVector<float> density(m_chunk_size.x * m_chunk_size.y * m_chunk_size.z);
+    m_noise_cache.getDensity(chunk->getPosition(), density.data());
+
+    VoxelStorage &voxels = chunk->getMutableVoxels();
+    glm::i32vec3 voxel_offsets = chunk->getPosition() * m_chunk_size;
+    glm::i32vec3 voxel_coords_in_chunk{0};
+    for (voxel_coords_in_chunk.y = 0; voxel_coords_in_chunk.y < m_chunk_size.y;
+         ++voxel_coords_in_chunk.y) {
+        int32_t voxel_y = voxel_offsets.y + voxel_coords_in_chunk.y;
+        int32_t real_y = voxel_y * m_chunk_size.y;
+
+        for (voxel_coords_in_chunk.z = 0; voxel_coords_in_chunk.z < m_chunk_size.z;
+             ++voxel_coords_in_chunk.z) {
+            for (voxel_coords_in_chunk.x = 0; voxel_coords_in_chunk.x < m_chunk_size.x;
+                 ++voxel_coords_in_chunk.x) {
+                int32_t index = chunk->voxelCoordsToIndex(voxel_coords_in_chunk);
+                float height = (density[index] + 0.6f) * 0.8f;
+
+                int32_t id = (static_cast<float>(voxel_y) / m_chunk_size.y) < height;
+
+                if (real_y <= 2)
+                    id = 2;
+
+                voxels.set(index, Voxel{id});
+            }
+        }
+    }
 }
 
 } // namespace eb
@@ -5,9 +5,31 @@
 #include "../Graphics/3D/ChunkMesh.h"
 #include "../Graphics/Common/RenderTarget.h"
 #include "../Graphics/Common/Texture.h"
+#include "../System/Clock.h"
+#include "../System/MemoryPool.h"
+#include "../System/ThreadPool.h"
 #include "Chunk.h"
+#include "../Utils/VecUtils.h"
+#include "BlockRegistry.h"
+#include "ChunkColliders.h"
+#include "ChunkMap.h"
+#include "EditJournal.h"
+#include "Noise.h"
+#include "NoiseCache.h"
+#include "RegionStorage.h"
+#include "Schematic.h"
 
+#include <filesystem>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <latch>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <type_traits>
 
 namespace eb {
 
@@ -19,13 +41,117 @@ class Chunks : public EngineObject
     friend class Chunk;
 
 public:
+    // Fills a chunk on a worker thread, must only write into the given chunk
+    using ChunkGenerator = std::function<void(Chunk *chunk, uint64_t chunk_seed)>;
+
+    // Chunks are generated in stages run in this order on the thread pool.
+    // A stage of a chunk starts once all its neighbours finished the previous
+    // stage, missing neighbours are generated up to that stage first.
+    enum class GenerationStage { TERRAIN, CARVING, DECORATION, LIGHTING };
+    static constexpr int32_t GENERATION_STAGES_COUNT = 4;
+    // Writes into the given chunk only. Neighbours are read from the snapshot,
+    // which holds them as they were right after the previous stage, so the
+    // result depends on the seed only and not on thread timing. Features
+    // crossing chunk borders are placed by every chunk they overlap, each
+    // writing its own part. Chunks loaded from storage are read as saved.
+    using GenerationStageFunc = std::function<
+        void(Chunk *chunk, const ChunkSnapshot &neighbours, uint64_t chunk_seed)>;
+    // Coarse view of a level cell, occupied_count of volume voxels are not air
+    struct LodCell
+    {
+        uint32_t occupied_count = 0;
+        uint32_t volume = 0;
+        Voxel material;
+    };
+
+    // Global coords, max_dist in global units along the direction
+    struct Ray
+    {
+        glm::vec3 origin{0.0f};
+        glm::vec3 direction{0.0f, 0.0f, 1.0f};
+        float max_dist = 0.0f;
+    };
+    struct RayHit
+    {
+        bool hit = false;
+        Voxel voxel;
+        glm::i32vec3 voxel_coords{0};
+        glm::vec3 position{0.0f};
+        // Face entered by the ray, zero when starting inside a solid voxel
+        glm::vec3 normal{0.0f};
+        float distance = 0.0f;
+    };
+
+    // Bytes held by a chunk. Copy-on-write buffers shared with snapshots are
+    // counted by the chunk only.
+    struct ChunkMemoryUsage
+    {
+        size_t voxels_bytes = 0;
+        size_t light_bytes = 0;
+        // Occupancy and LOD summaries
+        size_t summaries_bytes = 0;
+        size_t mesh_cpu_bytes = 0;
+        size_t mesh_gpu_bytes = 0;
+        bool uniform = false;
+        bool empty = false;
+        // Voxel bytes hold the compressed voxels and light map
+        bool dormant = false;
+    };
+    // Totals over generated chunks
+    struct MemoryUsage
+    {
+        int32_t chunks_count = 0;
+        int32_t uniform_chunks_count = 0;
+        int32_t empty_chunks_count = 0;
+        int32_t dormant_chunks_count = 0;
+        size_t voxels_bytes = 0;
+        size_t light_bytes = 0;
+        size_t summaries_bytes = 0;
+        size_t mesh_cpu_bytes = 0;
+        size_t mesh_gpu_bytes = 0;
+        MemoryPool::Stats pool;
+        NoiseCache::Stats noise_cache;
+    };
+    struct DormancyStats
+    {
+        int32_t dormant_chunks_count = 0;
+        // Resident bytes of the dormant chunks before and after compression
+        size_t raw_bytes = 0;
+        size_t compressed_bytes = 0;
+        uint64_t compressions_count = 0;
+        uint64_t decompressions_count = 0;
+        Time decompress_time;
+        Time max_decompress_time;
+    };
+
+    // Edits the voxel in place, returns false to leave it unchanged
+    using VoxelBrush = std::function<bool(const glm::i32vec3 &voxel_coords, Voxel &voxel)>;
+
+    // Fixed world: all chunks_size chunks are queued up front
     Chunks(const glm::i32vec3 &chunks_size,
            const glm::i32vec3 &chunk_size,
            float voxel_size,
            float texture_size,
            const std::shared_ptr<Texture> &atlas_texture,
-           Engine *engine);
-    ~Chunks() = default;
+           Engine *engine,
+           const std::filesystem::path &storage_path = {});
+    // Streaming world: chunks_height chunks tall and unbounded in x and z,
+    // chunks are loaded within view_radius around the focus point and
+    // unloaded beyond unload_radius.
+    // With a storage path chunks are loaded from region files when present
+    // and saved on unload, save() and destruction.
+    // Missing chunks are generated on the thread pool and become visible in
+    // update() once generated.
+    Chunks(int32_t chunks_height,
+           int32_t view_radius,
+           int32_t unload_radius,
+           const glm::i32vec3 &chunk_size,
+           float voxel_size,
+           float texture_size,
+           const std::shared_ptr<Texture> &atlas_texture,
+           Engine *engine,
+           const std::filesystem::path &storage_path = {});
+    ~Chunks();
 
     const glm::i32vec3 &getChunksSize() const;
     const glm::i32vec3 &getChunkSize() const;
@@ -33,36 +159,174 @@ public:
     float getTextureSize() const;
     std::shared_ptr<Texture> getAtlasTexture() const;
 
+    bool isStreaming() const;
+    int32_t getViewRadius() const;
+    int32_t getUnloadRadius() const;
+    void setViewRadius(int32_t view_radius, int32_t unload_radius);
+    int32_t getMaxChunkLoadsPerUpdate() const;
+    void setMaxChunkLoadsPerUpdate(int32_t max_chunk_loads);
+    const glm::i32vec3 &getFocusChunk() const;
+    void setFocus(const glm::vec3 &global_coords);
+    int32_t getLoadedChunksCount() const;
+
+    // Block properties are shared by meshing, lighting and ray casts, set
+    // them up before chunks are generated
+    BlockRegistry &getBlockRegistry();
+    const BlockRegistry &getBlockRegistry() const;
+
+    RegionStorage *getStorage() const;
+    // Saves the unsaved chunks, their edits are dropped from the edit journal
+    // once the region files reached the disk
+    void save();
+    // Worlds with storage log every voxel edit to a journal next to the region
+    // files. Edits a crash left in it are applied again when their chunks are
+    // loaded or generated.
+    EditJournal *getJournal() const;
+    // update() saves every interval, zero disables it
+    const Time &getSaveInterval() const;
+    void setSaveInterval(const Time &interval);
+
+    const Noise &getNoise() const;
+    // Column noise for generators, the default terrain reads its density
+    NoiseCache &getNoiseCache();
+    uint64_t getSeed() const;
+    void setSeed(uint64_t seed);
+    uint64_t getChunkSeed(const glm::i32vec3 &chunk_coords) const;
+    // Sets the terrain stage
+    void setGenerator(const ChunkGenerator &generator);
+    // Stages without a function are skipped
+    void setGenerationStage(GenerationStage stage, const GenerationStageFunc &func);
+    ThreadPool &getThreadPool();
+    int32_t getGeneratingChunksCount() const;
+
+    // Chunk LOD pyramids are built on the workers right after generation when
+    // enabled, otherwise on the first LOD query of each chunk
+    bool isLodEnabled() const;
+    void setLodEnabled(bool enabled);
+    // Level l cell covers 2^l voxels per axis. Cells larger than a chunk merge
+    // the pyramids of the covered chunks, only level 0 reads full voxel data.
+    // With other chunk sizes pyramid cells straddle the cell border, the
+    // overlap is summed from finer levels down to single voxels.
+    LodCell getLodCell(int32_t level, const glm::i32vec3 &cell_coords) const;
+
+    // Power of two chunk sizes address voxels with shifts and masks instead of
+    // divisions, other sizes fall back to floor division
+    bool isPowerOfTwoChunkSize() const;
+
+    glm::i32vec3 toChunkCoords(const glm::i32vec3 &voxel_coords) const;
+    glm::i32vec3 toLocalCoords(const glm::i32vec3 &voxel_coords) const;
+    glm::i32vec3 toVoxelCoords(const glm::vec3 &global_coords) const;
+
     Chunk *getChunk(const glm::i32vec3 &chunk_coords);
     Chunk *getChunkByVoxel(const glm::i32vec3 &voxel_coords);
     Chunk *getChunkByGlobal(const glm::vec3 &global_coords);
 
-    const Voxel *getVoxel(const glm::i32vec3 &voxel_coords) const;
-    const Voxel *getVoxelByGlobal(const glm::vec3 &global_coords) const;
+    std::optional<Voxel> getVoxel(const glm::i32vec3 &voxel_coords) const;
+    std::optional<Voxel> getVoxelByGlobal(const glm::vec3 &global_coords) const;
 
     void setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel);
     void setVoxelByGlobal(const glm::vec3 &global_coords, const Voxel &voxel);
 
+    // Bulk edits over inclusive voxel boxes. Chunks are visited one at a time
+    // and every touched chunk and border neighbour is marked modified once.
+    // Return the number of changed voxels.
+    int32_t fillBox(const glm::i32vec3 &min_voxel,
+                    const glm::i32vec3 &max_voxel,
+                    const Voxel &voxel);
+    int32_t fillSphere(const glm::i32vec3 &center, int32_t radius, const Voxel &voxel);
+    int32_t replace(const glm::i32vec3 &min_voxel,
+                    const glm::i32vec3 &max_voxel,
+                    const Voxel &from,
+                    const Voxel &to);
+    int32_t applyBrush(const glm::i32vec3 &min_voxel,
+                       const glm::i32vec3 &max_voxel,
+                       const VoxelBrush &brush);
+    // Pastes the schematic with its min corner at origin, clipped to generated
+    // chunks and written straight into their storage. With skip_air the air
+    // of the schematic keeps the world voxels.
+    int32_t stampSchematic(const Schematic &schematic,
+                           const glm::i32vec3 &origin,
+                           bool skip_air = false);
+    // Voxels of chunks that are not generated are copied as air
+    Schematic copySchematic(const glm::i32vec3 &min_voxel, const glm::i32vec3 &max_voxel) const;
+
     uint8_t getLight(const glm::i32vec3 &voxel_coords, int32_t channel) const;
 
+    // Opaque voxel, hides faces and stops light
     bool isVoxelBlocked(const glm::i32vec3 &voxel_coords) const;
+    bool isVoxelSolid(const glm::i32vec3 &voxel_coords) const;
+
+    // Voxel y just above the highest opaque voxel of the column at voxel x and
+    // z, zero when no loaded chunk of the column has one. Looks up the per
+    // chunk column heights from the top chunk down instead of scanning voxels.
+    int32_t getHeight(const glm::i32vec2 &column) const;
+
+    // Snapshot of a generated chunk and its loaded neighbours that worker
+    // threads can read while the chunks keep being edited. Both calls must be
+    // made on the thread editing the chunks.
+    ChunkSnapshot takeSnapshot(const glm::i32vec3 &chunk_coords) const;
+    // False once the chunk or a neighbour was edited, loaded or unloaded since
+    // the snapshot, results computed from it are stale then
+    bool isSnapshotCurrent(const ChunkSnapshot &snapshot) const;
 
     bool containsChunk(const glm::i32vec3 &chunk_coords) const;
     bool containsVoxel(const glm::i32vec3 &voxel_coords) const;
 
-    const Voxel *rayCast(glm::vec3 start,
-                         glm::vec3 direction,
-                         float max_dist,
-                         glm::vec3 &end,
-                         glm::vec3 &norm,
-                         glm::vec3 &iend);
+    std::optional<Voxel> rayCast(glm::vec3 start,
+                                 glm::vec3 direction,
+                                 float max_dist,
+                                 glm::vec3 &end,
+                                 glm::vec3 &norm,
+                                 glm::vec3 &iend);
+    // Rays are traced in packets of RAY_PACKET_SIZE stepped together, each ray
+    // keeps the chunk it is in between steps. Rays stop at the first solid
+    // voxel, at unloaded chunks or at max_dist. hits must hold rays.size() entries.
+    void rayCastBatch(std::span<const Ray> rays, std::span<RayHit> hits) const;
+    // Splits packets across the thread pool and waits for them. Must not be
+    // called from a pool task.
+    void rayCastBatchParallel(std::span<const Ray> rays, std::span<RayHit> hits);
+    // Logs rays per second of random short and long rays from loaded chunks
+    void benchmarkRayCasts(int32_t rays_count = 1 << 16);
 
-    void forEachVoxels(
-        const std::function<void(const glm::i32vec3 &, const glm::i32vec3 &)> &func) const;
+    // Visitors are called chunk by chunk as func(voxel_coords_in_chunk, voxel_coords)
+    // or func(voxel_coords_in_chunk, voxel_coords, voxel) with the voxel read
+    // straight from chunk storage
+    template<typename F>
+    void forEachVoxels(F &&func) const;
+    template<typename F>
+    void forEachVoxelsInChunk(const glm::i32vec3 &chunk_coords, F &&func) const;
+    // Splits chunks across the thread pool and waits for them, func must be
+    // thread safe. Must not be called from a pool task.
+    template<typename F>
+    void forEachVoxelsParallel(F &&func);
+    // Logs voxels per second of forEachVoxels() and forEachVoxelsParallel()
+    // over the loaded chunks
+    void benchmarkVoxelVisits(int32_t passes = 4);
+    // Logs chunks per second of ChunkMesh::create() over the loaded chunks,
+    // must be called from the thread owning the graphics context
+    void benchmarkMeshing(int32_t passes = 4);
 
-    void forEachVoxelsInChunk(
-        const glm::i32vec3 &chunk_coords,
-        const std::function<void(const glm::i32vec3 &, const glm::i32vec3 &)> &func) const;
+    // Generated chunks untouched for the delay are compressed in memory, see
+    // Chunk::isDormant(). Streaming worlds keep chunks in view radius awake.
+    // Zero disables dormancy.
+    const Time &getDormancyDelay() const;
+    void setDormancyDelay(const Time &delay);
+    DormancyStats getDormancyStats() const;
+
+    // Terrain collision as static bodies in the physics world, bodies of
+    // edited chunks are rebuilt in update(). Passing nullptrs removes the
+    // bodies, which must happen before the physics world is destroyed.
+    void setPhysicsWorld(reactphysics3d::PhysicsCommon *physics_common,
+                         reactphysics3d::PhysicsWorld *physics_world);
+    ChunkColliders *getColliders() const;
+
+    // Zero for chunks that are not generated
+    ChunkMemoryUsage getChunkMemoryUsage(const glm::i32vec3 &chunk_coords) const;
+    MemoryUsage getMemoryUsage() const;
+    void logMemoryUsage() const;
+    // update() logs the memory usage every interval, zero disables it
+    const Time &getMemoryLogInterval() const;
+    void setMemoryLogInterval(const Time &interval);
 
     void update();
 
@@ -70,48 +334,316 @@ public:
     void draw(const RenderTarget &render_target) const;
 
 private:
-    int32_t chunkCoordsToIndex(const glm::i32vec3 &chunk_coords) const;
+    Chunk *findChunk(const glm::i32vec3 &chunk_coords) const;
+    void markChunkModified(const glm::i32vec3 &chunk_coords);
+    // Marks an edited chunk and the neighbours next to the edited bounds
+    void markChunkEdited(const glm::i32vec3 &chunk_coords,
+                         const glm::i32vec3 &changed_min,
+                         const glm::i32vec3 &changed_max);
+
+    template<typename F>
+    void forEachVoxelsInChunk(const Chunk *chunk, F &func) const;
+
+    void loadJournal();
+    void journalEdit(const Chunk *chunk, int32_t index, const Voxel &voxel);
+    void applyJournalEdits(Chunk *chunk, const std::vector<EditJournal::Record> &edits);
+    int32_t fillChunk(Chunk *chunk, const Voxel &voxel);
+
+    void rayCastPacket(const Ray *rays, RayHit *hits, int32_t count) const;
 
-    void setChunkData(const glm::i32vec3 &chunk_coords);
+    template<typename Func>
+    int32_t editChunks(const glm::i32vec3 &min_voxel, const glm::i32vec3 &max_voxel, Func &&func);
+    template<typename Func>
+    int32_t editVoxels(Chunk *chunk,
+                       const glm::i32vec3 &local_min,
+                       const glm::i32vec3 &local_max,
+                       Func &&func,
+                       glm::i32vec3 &changed_min,
+                       glm::i32vec3 &changed_max);
+
+    // Loads the chunk or generates it up to target_stage completed stages
+    void loadChunk(const glm::i32vec3 &chunk_coords, int32_t target_stage);
+    void unloadChunk(const glm::i32vec3 &chunk_coords);
+    bool isInRadius(const glm::i32vec3 &chunk_coords, int32_t radius) const;
+    // Partially generated chunks are kept further out, chunks in view need them
+    bool isInUnloadRadius(const glm::i32vec3 &chunk_coords) const;
+    bool isInWorld(const glm::i32vec3 &chunk_coords) const;
+    void updateStreaming();
+    void loadChunks();
+    void finishGeneratedChunks();
+    void finishChunk(const glm::i32vec3 &chunk_coords);
+    void finishStage(const glm::i32vec3 &chunk_coords);
+    // Starts the next stage of every queued chunk whose neighbours are ready
+    void scheduleStages();
+    void scheduleStage(const glm::i32vec3 &chunk_coords);
+    void raiseTargetStage(const glm::i32vec3 &chunk_coords, int32_t target_stage);
+    void queueStageNeighbours(const glm::i32vec3 &chunk_coords);
+    // Drops stage data once the chunk and all its neighbours are generated.
+    // Streaming worlds may unload a neighbour and generate it again, they keep
+    // the entries read by the stages that have a function.
+    void releaseStageEntries(const glm::i32vec3 &chunk_coords);
+    bool isStageEntryNeeded(int32_t stage) const;
+    // Connects the neighbour links of a generated chunk both ways
+    void linkChunk(Chunk *chunk);
+    void unlinkChunk(Chunk *chunk);
+    // Rebuilds chunk summaries made with older block properties
+    void updateBlockRegistry();
+    void compressDormantChunks();
+    void onChunkDecompressed(const Time &time);
+
+    void setChunkData(Chunk *chunk) const;
 
 private:
+    static constexpr int32_t RAY_PACKET_SIZE = 8;
+    static constexpr int32_t MAX_DORMANT_CHUNKS_PER_UPDATE = 64;
+
     struct ChunkState
     {
+        enum State { GENERATING, GENERATED };
+
         ChunkState() {}
         ChunkState(const glm::i32vec3 &position,
                    Chunks *chunks,
                    const std::shared_ptr<Texture> &texture,
                    Engine *engine)
-            : chunk{std::make_unique<Chunk>(position, chunks)}
-            , mesh{std::make_unique<ChunkMesh>(engine, texture)}
+            : state{GENERATING}
+            , chunk{makePooled<Chunk>(position, chunks)}
+            , mesh{makePooled<ChunkMesh>(engine, texture)}
         {}
 
         ChunkState(ChunkState &&other)
-            : chunk{std::move(other.chunk)}
+            : state{other.state}
+            , chunk{std::move(other.chunk)}
             , mesh{std::move(other.mesh)}
+            , stage{other.stage}
+            , target_stage{other.target_stage}
+            , stage_running{other.stage_running}
+            , stage_entries{std::move(other.stage_entries)}
         {}
 
         ChunkState &operator=(ChunkState &&other)
         {
+            state = other.state;
             chunk = std::move(other.chunk);
             mesh = std::move(other.mesh);
+            stage = other.stage;
+            target_stage = other.target_stage;
+            stage_running = other.stage_running;
+            stage_entries = std::move(other.stage_entries);
             return *this;
         }
 
-        std::unique_ptr<Chunk> chunk;
-        std::unique_ptr<ChunkMesh> mesh;
+        State state = GENERATING;
+        PoolPtr<Chunk> chunk;
+        PoolPtr<ChunkMesh> mesh;
+
+        // Completed generation stages, the chunk is generated at
+        // GENERATION_STAGES_COUNT
+        int32_t stage = 0;
+        int32_t target_stage = 0;
+        bool stage_running = false;
+        // Chunk data after every completed stage, read by neighbour stages
+        std::array<ChunkSnapshot::Entry, GENERATION_STAGES_COUNT> stage_entries;
     };
 
     glm::i32vec3 m_chunks_size;
     glm::i32vec3 m_chunk_size;
+    bool m_pow2_chunk_size;
+    glm::i32vec3 m_chunk_shift;
+    glm::i32vec3 m_chunk_mask;
     float m_voxel_size;
     float m_texture_size;
     std::shared_ptr<Texture> m_atlas_texture;
 
-    std::vector<std::unique_ptr<ChunkState>> m_chunk_states;
+    bool m_streaming;
+    int32_t m_view_radius;
+    int32_t m_unload_radius;
+    int32_t m_max_chunk_loads;
+    glm::i32vec3 m_focus_chunk;
+    bool m_focus_changed;
+    std::vector<glm::i32vec3> m_load_queue;
+
+    BlockRegistry m_block_registry;
+    uint32_t m_block_registry_version;
+    std::unique_ptr<RegionStorage> m_storage;
+    std::unique_ptr<EditJournal> m_journal;
+    // Journal edits of chunks not loaded since the start
+    ChunkMap<std::vector<EditJournal::Record>> m_journal_edits;
+    Time m_save_interval;
+    Clock m_save_clock;
+
+    uint64_t m_seed;
+    Noise m_noise;
+    mutable NoiseCache m_noise_cache;
+    std::array<GenerationStageFunc, GENERATION_STAGES_COUNT> m_generation_stages;
+    // Running stage tasks, chunks whose stage task finished and chunks
+    // waiting to schedule their next stage
+    int32_t m_generating_chunks;
+    std::mutex m_generated_mutex;
+    std::vector<glm::i32vec3> m_generated_chunks;
+    std::vector<glm::i32vec3> m_finished_chunks;
+    std::vector<glm::i32vec3> m_stage_queue;
+    ThreadPool m_thread_pool;
+
+    bool m_lod_enabled;
+
+    ChunkMap<PoolPtr<ChunkState>> m_chunk_states;
     bool m_chunks_modfied;
+    std::unique_ptr<ChunkColliders> m_colliders;
+
+    Time m_memory_log_interval;
+    Clock m_memory_log_clock;
+
+    Time m_update_time;
+    Time m_dormancy_delay;
+    Clock m_dormancy_clock;
+    std::vector<uint8_t> m_dormancy_buffer;
+    uint64_t m_compressions_count;
+    std::atomic<uint64_t> m_decompressions_count;
+    std::atomic<int64_t> m_decompress_time;
+    std::atomic<int64_t> m_max_decompress_time;
 };
 
+inline glm::i32vec3 Chunks::toChunkCoords(const glm::i32vec3 &voxel_coords) const
+{
+    // Arithmetic shift right floors negative coords too
+    if (m_pow2_chunk_size)
+        return voxel_coords >> m_chunk_shift;
+
+    return {floorDiv(voxel_coords.x, m_chunk_size.x),
+            floorDiv(voxel_coords.y, m_chunk_size.y),
+            floorDiv(voxel_coords.z, m_chunk_size.z)};
+}
+
+inline glm::i32vec3 Chunks::toLocalCoords(const glm::i32vec3 &voxel_coords) const
+{
+    if (m_pow2_chunk_size)
+        return voxel_coords & m_chunk_mask;
+
+    return voxel_coords - toChunkCoords(voxel_coords) * m_chunk_size;
+}
+
+inline Chunk *Chunks::findChunk(const glm::i32vec3 &chunk_coords) const
+{
+    auto *chunk_state = m_chunk_states.find(chunk_coords);
+    return chunk_state && (*chunk_state)->state == ChunkState::GENERATED
+               ? (*chunk_state)->chunk.get()
+               : nullptr;
+}
+
+inline void Chunks::journalEdit(const Chunk *chunk, int32_t index, const Voxel &voxel)
+{
+    if (m_journal)
+        m_journal->append({chunk->getPosition(), index, voxel});
+}
+
+inline std::optional<Voxel> Chunks::getVoxel(const glm::i32vec3 &voxel_coords) const
+{
+    Chunk *chunk = findChunk(toChunkCoords(voxel_coords));
+    if (!chunk)
+        return std::nullopt;
+    return chunk->getVoxels().get(chunk->voxelCoordsToIndex(toLocalCoords(voxel_coords)));
+}
+
+inline uint8_t Chunks::getLight(const glm::i32vec3 &voxel_coords, int32_t channel) const
+{
+    Chunk *chunk = findChunk(toChunkCoords(voxel_coords));
+    return chunk ? chunk->getLightmap().get(toLocalCoords(voxel_coords), channel) : 0;
+}
+
+inline bool Chunks::isVoxelBlocked(const glm::i32vec3 &voxel_coords) const
+{
+    const Chunk *chunk = findChunk(toChunkCoords(voxel_coords));
+    return chunk && chunk->getOccupancy().isOpaque(toLocalCoords(voxel_coords));
+}
+
+inline bool Chunks::isVoxelSolid(const glm::i32vec3 &voxel_coords) const
+{
+    auto voxel = getVoxel(voxel_coords);
+    return voxel && m_block_registry.isSolid(voxel->id);
+}
+
+inline bool Chunks::containsChunk(const glm::i32vec3 &chunk_coords) const
+{
+    return m_chunk_states.contains(chunk_coords);
+}
+
+inline bool Chunks::containsVoxel(const glm::i32vec3 &voxel_coords) const
+{
+    return containsChunk(toChunkCoords(voxel_coords));
+}
+
+template<typename F>
+void Chunks::forEachVoxels(F &&func) const
+{
+    m_chunk_states.forEach([this, &func](const glm::i32vec3 &,
+                                         const PoolPtr<ChunkState> &chunk_state) {
+        if (chunk_state->state == ChunkState::GENERATED)
+            forEachVoxelsInChunk(chunk_state->chunk.get(), func);
+    });
+}
+
+template<typename F>
+void Chunks::forEachVoxelsInChunk(const glm::i32vec3 &chunk_coords, F &&func) const
+{
+    if (const Chunk *chunk = findChunk(chunk_coords))
+        forEachVoxelsInChunk(chunk, func);
+}
+
+template<typename F>
+void Chunks::forEachVoxelsParallel(F &&func)
+{
+    std::vector<const Chunk *> chunks;
+    m_chunk_states.forEach(
+        [&chunks](const glm::i32vec3 &, const PoolPtr<ChunkState> &chunk_state) {
+            if (chunk_state->state == ChunkState::GENERATED)
+                chunks.push_back(chunk_state->chunk.get());
+        });
+
+    if (chunks.empty())
+        return;
+
+    // A few tasks per thread keeps threads busy when chunks cost differently
+    const int32_t tasks_count = std::min<int32_t>(chunks.size(),
+                                                  m_thread_pool.getThreadsCount() * 4);
+    std::latch tasks_latch{tasks_count};
+    for (int32_t task = 0; task < tasks_count; ++task) {
+        m_thread_pool.enqueue([this, &func, &chunks, &tasks_latch, task, tasks_count]() {
+            for (size_t i = task; i < chunks.size(); i += tasks_count)
+                forEachVoxelsInChunk(chunks[i], func);
+            tasks_latch.count_down();
+        });
+    }
+    tasks_latch.wait();
+}
+
+template<typename F>
+void Chunks::forEachVoxelsInChunk(const Chunk *chunk, F &func) const
+{
+    const glm::i32vec3 voxel_offsets = chunk->getPosition() * m_chunk_size;
+    glm::i32vec3 voxel_coords{0};
+
+    // Storage index order is x, then z, then y
+    chunk->getVoxels().forEach([this, &func, &voxel_offsets, &voxel_coords](int32_t,
+                                                                           const Voxel &voxel) {
+        if constexpr (std::is_invocable_v<F &,
+                                          const glm::i32vec3 &,
+                                          const glm::i32vec3 &,
+                                          const Voxel &>)
+            func(voxel_coords, voxel_offsets + voxel_coords, voxel);
+        else
+            func(voxel_coords, voxel_offsets + voxel_coords);
+
+        if (++voxel_coords.x == m_chunk_size.x) {
+            voxel_coords.x = 0;
+            if (++voxel_coords.z == m_chunk_size.z) {
+                voxel_coords.z = 0;
+                ++voxel_coords.y;
+            }
+        }
+    });
+}
+
 } // namespace eb
 
 #endif // EB_VOXEL_CHUNKS_H
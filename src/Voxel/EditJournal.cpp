@@ -0,0 +1,320 @@
+#include "EditJournal.h"
+#include "../Utils/BinaryStream.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace eb {
+
+struct BatchHeader
+{
+    uint32_t size;
+    uint32_t checksum;
+};
+
+// Larger buffers are written without waiting for the flush interval
+static constexpr size_t MAX_BUFFER_SIZE = 1 << 20;
+
+static uint32_t checksum(const uint8_t *data, size_t size)
+{
+    // FNV-1a
+    uint32_t hash = 0x811c9dc5u;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ data[i]) * 0x01000193u;
+    return hash;
+}
+
+static void writeRecord(BinaryWriter &writer, const EditJournal::Record &record)
+{
+    writer.writeVarInt(record.chunk_coords.x);
+    writer.writeVarInt(record.chunk_coords.y);
+    writer.writeVarInt(record.chunk_coords.z);
+    writer.writeVarUInt(static_cast<uint32_t>(record.index + 1));
+    writer.writeVarInt(record.voxel.id);
+}
+
+static std::vector<uint8_t> readFile(const std::filesystem::path &path)
+{
+    std::vector<uint8_t> data;
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return data;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        data.resize(file_stat.st_size);
+        if (pread(fd, data.data(), data.size(), 0) != static_cast<ssize_t>(data.size()))
+            data.clear();
+    }
+    ::close(fd);
+    return data;
+}
+
+static bool syncDirectory(const std::filesystem::path &path)
+{
+    const std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : ".";
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+
+    const bool result = fsync(fd) == 0;
+    ::close(fd);
+    return result;
+}
+
+// Size of the whole batches at the start of data
+static size_t parseBatches(const std::vector<uint8_t> &data,
+                           std::vector<EditJournal::Record> *records)
+{
+    size_t offset = 0;
+    while (data.size() - offset > sizeof(BatchHeader)) {
+        BatchHeader header;
+        memcpy(&header, data.data() + offset, sizeof(BatchHeader));
+        const uint8_t *batch = data.data() + offset + sizeof(BatchHeader);
+        if (header.size == 0 || header.size > data.size() - offset - sizeof(BatchHeader)
+            || checksum(batch, header.size) != header.checksum)
+            break;
+
+        BinaryReader reader{batch, header.size};
+        while (records && !reader.isEnd()) {
+            EditJournal::Record record;
+            record.chunk_coords.x = static_cast<int32_t>(reader.readVarInt());
+            record.chunk_coords.y = static_cast<int32_t>(reader.readVarInt());
+            record.chunk_coords.z = static_cast<int32_t>(reader.readVarInt());
+            record.index = static_cast<int32_t>(reader.readVarUInt()) - 1;
+            record.voxel.id = static_cast<int32_t>(reader.readVarInt());
+            if (!reader.isValid())
+                break;
+            records->push_back(record);
+        }
+        offset += sizeof(BatchHeader) + header.size;
+    }
+    return offset;
+}
+
+EditJournal::EditJournal(const std::filesystem::path &path, const Time &flush_interval)
+    : m_path{path}
+    , m_flush_interval{flush_interval}
+    , m_fd{-1}
+    , m_appended_count{0}
+    , m_written_count{0}
+    , m_flush_requested{false}
+    , m_stop{false}
+{
+    // A batch torn by a crash would hide the batches appended after it
+    const std::vector<uint8_t> data = readFile(m_path);
+    const size_t valid_size = parseBatches(data, nullptr);
+    if (valid_size < data.size()) {
+        spdlog::warn("Dropped {} bytes of torn edit journal batches: {}",
+                     data.size() - valid_size,
+                     m_path.string());
+        if (truncate(m_path.c_str(), valid_size) != 0)
+            spdlog::error("Failed to truncate edit journal: {}", m_path.string());
+    }
+
+    open();
+    m_thread = std::thread{&EditJournal::run, this};
+}
+
+EditJournal::~EditJournal()
+{
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_stop = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+const std::filesystem::path &EditJournal::getPath() const
+{
+    return m_path;
+}
+
+bool EditJournal::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+EditJournal::Stats EditJournal::getStats() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    return m_stats;
+}
+
+void EditJournal::append(const Record &record)
+{
+    bool write_now = false;
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        BinaryWriter writer{m_buffer};
+        writeRecord(writer, record);
+        ++m_appended_count;
+        ++m_stats.records_count;
+        if (m_buffer.size() >= MAX_BUFFER_SIZE && !m_flush_requested)
+            write_now = m_flush_requested = true;
+    }
+    if (write_now)
+        m_condition.notify_one();
+}
+
+bool EditJournal::flush()
+{
+    std::unique_lock<std::mutex> lock{m_mutex};
+    const uint64_t appended_count = m_appended_count;
+    const uint64_t failed_writes_count = m_stats.failed_writes_count;
+    if (m_written_count >= appended_count)
+        return true;
+
+    m_flush_requested = true;
+    m_condition.notify_one();
+    m_flushed_condition.wait(lock, [this, appended_count, failed_writes_count]() {
+        return m_written_count >= appended_count
+               || m_stats.failed_writes_count != failed_writes_count;
+    });
+    return m_written_count >= appended_count;
+}
+
+std::vector<EditJournal::Record> EditJournal::read() const
+{
+    std::vector<Record> records;
+    parseBatches(readFile(m_path), &records);
+    return records;
+}
+
+bool EditJournal::compact(std::span<const Record> records)
+{
+    std::lock_guard<std::mutex> file_lock{m_file_mutex};
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_buffer.clear();
+        m_written_count = m_appended_count;
+        ++m_stats.compactions_count;
+    }
+    m_flushed_condition.notify_all();
+
+    std::vector<uint8_t> records_data;
+    BinaryWriter writer{records_data};
+    for (const auto &record : records)
+        writeRecord(writer, record);
+
+    // The kept records replace the log in one rename, a crash leaves either
+    // the old or the new log
+    std::filesystem::path temp_path = m_path;
+    temp_path += ".tmp";
+    const int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        spdlog::error("Failed to compact edit journal: {}", m_path.string());
+        return false;
+    }
+
+    const int old_fd = m_fd;
+    m_fd = fd;
+    const bool result = records_data.empty() ? fdatasync(fd) == 0 : writeBatch(records_data);
+    m_fd = old_fd;
+    ::close(fd);
+    if (!result || rename(temp_path.c_str(), m_path.c_str()) != 0) {
+        spdlog::error("Failed to compact edit journal: {}", m_path.string());
+        return false;
+    }
+
+    if (m_fd >= 0)
+        ::close(m_fd);
+    const bool opened = open();
+
+    // The rename reaches the disk with the directory
+    if (!syncDirectory(m_path)) {
+        spdlog::error("Failed to sync edit journal directory: {}", m_path.string());
+        return false;
+    }
+    return opened;
+}
+
+void EditJournal::run()
+{
+    std::vector<uint8_t> batch;
+    std::unique_lock<std::mutex> lock{m_mutex};
+    while (true) {
+        m_condition.wait_for(lock,
+                             std::chrono::microseconds{m_flush_interval.asMicroseconds()},
+                             [this]() { return m_stop || m_flush_requested; });
+        m_flush_requested = false;
+        const bool stop = m_stop;
+        lock.unlock();
+
+        // Taken before the buffer, compaction must not drop records between
+        // the swap and the write
+        std::lock_guard<std::mutex> file_lock{m_file_mutex};
+        lock.lock();
+        const uint64_t appended_count = m_appended_count;
+        batch.clear();
+        std::swap(batch, m_buffer);
+        lock.unlock();
+
+        const bool written = batch.empty() || writeBatch(batch);
+
+        lock.lock();
+        if (written) {
+            if (!batch.empty()) {
+                ++m_stats.batches_count;
+                m_stats.written_bytes += sizeof(BatchHeader) + batch.size();
+            }
+            m_written_count = std::max(m_written_count, appended_count);
+        } else {
+            // Retried ahead of the newer records on the next flush interval
+            batch.insert(batch.end(), m_buffer.begin(), m_buffer.end());
+            std::swap(batch, m_buffer);
+            ++m_stats.failed_writes_count;
+            if (stop)
+                spdlog::error("Dropped unwritten edit journal records: {}", m_path.string());
+        }
+        m_flushed_condition.notify_all();
+        if (stop)
+            return;
+    }
+}
+
+bool EditJournal::writeBatch(const std::vector<uint8_t> &records_data)
+{
+    if (m_fd < 0)
+        return false;
+
+    // Header and records go out in one write
+    std::vector<uint8_t> data(sizeof(BatchHeader) + records_data.size());
+    const BatchHeader header{static_cast<uint32_t>(records_data.size()),
+                             checksum(records_data.data(), records_data.size())};
+    memcpy(data.data(), &header, sizeof(BatchHeader));
+    memcpy(data.data() + sizeof(BatchHeader), records_data.data(), records_data.size());
+
+    const off_t file_size = lseek(m_fd, 0, SEEK_END);
+    if (write(m_fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())
+        || fdatasync(m_fd) != 0) {
+        spdlog::error("Failed to write edit journal: {}", m_path.string());
+        // A torn batch would hide the retried batch appended after it
+        if (file_size >= 0 && ftruncate(m_fd, file_size) != 0)
+            spdlog::error("Failed to truncate edit journal: {}", m_path.string());
+        return false;
+    }
+    return true;
+}
+
+bool EditJournal::open()
+{
+    m_fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (m_fd < 0) {
+        spdlog::error("Failed to open edit journal: {}", m_path.string());
+        return false;
+    }
+    return true;
+}
+
+} // namespace eb
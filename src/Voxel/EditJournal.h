@@ -0,0 +1,95 @@
+#ifndef EB_VOXEL_EDITJOURNAL_H
+#define EB_VOXEL_EDITJOURNAL_H
+
+#include "../System/Time.h"
+#include "../Utils/NoCopyable.h"
+#include "Voxel.h"
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace eb {
+
+// Write ahead log of voxel edits. Records are buffered and appended to the
+// file in batches by a background thread, every batch is checksummed so a
+// torn batch at the end of the file is dropped on read. Records set absolute
+// values, replaying a log over chunks saved after some of its records gives
+// the same voxels as replaying it over the chunks before them.
+class EditJournal : public NoCopyable
+{
+public:
+    // Whole chunk fill instead of a single voxel
+    static constexpr int32_t FILL_INDEX = -1;
+
+    struct Record
+    {
+        glm::i32vec3 chunk_coords{0};
+        // Chunk::voxelCoordsToIndex or FILL_INDEX
+        int32_t index = 0;
+        Voxel voxel;
+    };
+    struct Stats
+    {
+        uint64_t records_count = 0;
+        uint64_t batches_count = 0;
+        uint64_t written_bytes = 0;
+        uint64_t compactions_count = 0;
+        uint64_t failed_writes_count = 0;
+    };
+
+    EditJournal(const std::filesystem::path &path, const Time &flush_interval = milliseconds(100));
+    // Writes the buffered records
+    ~EditJournal();
+
+    const std::filesystem::path &getPath() const;
+    bool isOpen() const;
+    Stats getStats() const;
+
+    void append(const Record &record);
+    // Writes the buffered records and waits for them to reach the disk, false
+    // when the write failed. Failed records stay buffered and are retried.
+    bool flush();
+    // Records of the file in append order
+    std::vector<Record> read() const;
+    // Replaces the file with the given records once the edits of every other
+    // record are saved elsewhere. Buffered records are dropped.
+    bool compact(std::span<const Record> records);
+
+private:
+    void run();
+    // Appends one batch and waits for it to reach the disk, a failed batch is cut off
+    bool writeBatch(const std::vector<uint8_t> &records_data);
+    bool open();
+
+private:
+    std::filesystem::path m_path;
+    Time m_flush_interval;
+    int m_fd;
+
+    // Guards the file, taken by batch writes and compaction
+    std::mutex m_file_mutex;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::condition_variable m_flushed_condition;
+    std::vector<uint8_t> m_buffer;
+    // Records appended and records written to the file or dropped by
+    // compaction, flush() waits for them to match or for a failed write
+    uint64_t m_appended_count;
+    uint64_t m_written_count;
+    bool m_flush_requested;
+    bool m_stop;
+    Stats m_stats;
+    std::thread m_thread;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_EDITJOURNAL_H
@@ -0,0 +1,450 @@
+#include "Noise.h"
+#include "../System/Clock.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define EB_NOISE_X86 1
+#include <immintrin.h>
+#endif
+
+// Every path must evaluate the same float operations in the same order and
+// this file is compiled with -ffp-contract=off, which keeps the paths bit exact
+
+namespace eb {
+
+static constexpr uint32_t PRIME_X = 0x8da6b343u;
+static constexpr uint32_t PRIME_Y = 0xd8163841u;
+static constexpr uint32_t PRIME_Z = 0xcb1ab31fu;
+static constexpr uint32_t PRIME_MIX = 0x2c1b3c6du;
+static constexpr uint32_t SIGN_BIT = 0x80000000u;
+static constexpr uint32_t OCTAVE_SEED_STEP = 0x9e3779b9u;
+// Brings cube corner gradient noise to roughly [-1, 1]
+static constexpr float NOISE_SCALE = 0.75f;
+
+// Values shared by the whole row, y and z do not change along it
+struct RowParams
+{
+    float start_x;
+    float step_x;
+    float amplitude;
+    float fy0, fy1, fz0, fz1;
+    float v, w;
+    uint32_t seeds[4]; // seed ^ hash of y and z, indexed by (dz << 1) | dy
+};
+
+static inline int32_t fastFloor(float value)
+{
+    int32_t result = static_cast<int32_t>(value);
+    return result - (value < static_cast<float>(result));
+}
+
+static inline float fade(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static inline float lerp(float a, float b, float t)
+{
+    return a + t * (b - a);
+}
+
+static inline uint32_t mixHash(uint32_t hash)
+{
+    hash ^= hash >> 15;
+    hash *= PRIME_MIX;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+static inline float flipSign(float value, uint32_t sign)
+{
+    return std::bit_cast<float>(std::bit_cast<uint32_t>(value) ^ sign);
+}
+
+// Dot product with a cube corner gradient picked by the hash bits
+static inline float gradDot(uint32_t hash, float x, float y, float z)
+{
+    return flipSign(x, hash << 31) + flipSign(y, (hash << 30) & SIGN_BIT)
+           + flipSign(z, (hash << 29) & SIGN_BIT);
+}
+
+static RowParams makeRowParams(
+    const glm::vec3 &start, float step_x, float amplitude, uint32_t seed)
+{
+    RowParams params;
+    params.start_x = start.x;
+    params.step_x = step_x;
+    params.amplitude = amplitude;
+
+    int32_t yi = fastFloor(start.y);
+    int32_t zi = fastFloor(start.z);
+    params.fy0 = start.y - static_cast<float>(yi);
+    params.fz0 = start.z - static_cast<float>(zi);
+    params.fy1 = params.fy0 - 1.0f;
+    params.fz1 = params.fz0 - 1.0f;
+    params.v = fade(params.fy0);
+    params.w = fade(params.fz0);
+
+    uint32_t hy0 = static_cast<uint32_t>(yi) * PRIME_Y;
+    uint32_t hz0 = static_cast<uint32_t>(zi) * PRIME_Z;
+    params.seeds[0] = seed ^ hy0 ^ hz0;
+    params.seeds[1] = seed ^ (hy0 + PRIME_Y) ^ hz0;
+    params.seeds[2] = seed ^ hy0 ^ (hz0 + PRIME_Z);
+    params.seeds[3] = seed ^ (hy0 + PRIME_Y) ^ (hz0 + PRIME_Z);
+    return params;
+}
+
+static void addRowScalar(const RowParams &params, int32_t first, int32_t count, float *out)
+{
+    for (int32_t i = first; i < count; ++i) {
+        float x = params.start_x + static_cast<float>(i) * params.step_x;
+        int32_t xi = fastFloor(x);
+        float fx0 = x - static_cast<float>(xi);
+        float fx1 = fx0 - 1.0f;
+        float u = fade(fx0);
+
+        uint32_t hx0 = static_cast<uint32_t>(xi) * PRIME_X;
+        uint32_t hx1 = hx0 + PRIME_X;
+
+        float n000 = gradDot(mixHash(hx0 ^ params.seeds[0]), fx0, params.fy0, params.fz0);
+        float n100 = gradDot(mixHash(hx1 ^ params.seeds[0]), fx1, params.fy0, params.fz0);
+        float n010 = gradDot(mixHash(hx0 ^ params.seeds[1]), fx0, params.fy1, params.fz0);
+        float n110 = gradDot(mixHash(hx1 ^ params.seeds[1]), fx1, params.fy1, params.fz0);
+        float n001 = gradDot(mixHash(hx0 ^ params.seeds[2]), fx0, params.fy0, params.fz1);
+        float n101 = gradDot(mixHash(hx1 ^ params.seeds[2]), fx1, params.fy0, params.fz1);
+        float n011 = gradDot(mixHash(hx0 ^ params.seeds[3]), fx0, params.fy1, params.fz1);
+        float n111 = gradDot(mixHash(hx1 ^ params.seeds[3]), fx1, params.fy1, params.fz1);
+
+        float ny0 = lerp(lerp(n000, n100, u), lerp(n010, n110, u), params.v);
+        float ny1 = lerp(lerp(n001, n101, u), lerp(n011, n111, u), params.v);
+        float noise = lerp(ny0, ny1, params.w);
+
+        out[i] = out[i] + noise * NOISE_SCALE * params.amplitude;
+    }
+}
+
+#ifdef EB_NOISE_X86
+
+__attribute__((target("sse4.1"))) static void addRowSse41(const RowParams &params,
+                                                          int32_t count,
+                                                          float *out)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 six = _mm_set1_ps(6.0f);
+    const __m128 fifteen = _mm_set1_ps(15.0f);
+    const __m128 ten = _mm_set1_ps(10.0f);
+    const __m128i sign_bit = _mm_set1_epi32(SIGN_BIT);
+    const __m128i prime_x = _mm_set1_epi32(PRIME_X);
+    const __m128i prime_mix = _mm_set1_epi32(PRIME_MIX);
+    const __m128 start_x = _mm_set1_ps(params.start_x);
+    const __m128 step_x = _mm_set1_ps(params.step_x);
+    const __m128 scale = _mm_set1_ps(NOISE_SCALE);
+    const __m128 amplitude = _mm_set1_ps(params.amplitude);
+    const __m128 fy[2] = {_mm_set1_ps(params.fy0), _mm_set1_ps(params.fy1)};
+    const __m128 fz[2] = {_mm_set1_ps(params.fz0), _mm_set1_ps(params.fz1)};
+    const __m128 v = _mm_set1_ps(params.v);
+    const __m128 w = _mm_set1_ps(params.w);
+    const __m128i seeds[4] = {_mm_set1_epi32(params.seeds[0]),
+                              _mm_set1_epi32(params.seeds[1]),
+                              _mm_set1_epi32(params.seeds[2]),
+                              _mm_set1_epi32(params.seeds[3])};
+
+    int32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_add_ps(start_x,
+                              _mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(i, i + 1, i + 2, i + 3)),
+                                         step_x));
+        __m128i xi = _mm_cvttps_epi32(x);
+        // Adding the all ones compare mask subtracts one where truncation rounded up
+        xi = _mm_add_epi32(xi, _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(xi))));
+        __m128 fx[2];
+        fx[0] = _mm_sub_ps(x, _mm_cvtepi32_ps(xi));
+        fx[1] = _mm_sub_ps(fx[0], one);
+        __m128 u = _mm_mul_ps(
+            _mm_mul_ps(_mm_mul_ps(fx[0], fx[0]), fx[0]),
+            _mm_add_ps(_mm_mul_ps(fx[0], _mm_sub_ps(_mm_mul_ps(fx[0], six), fifteen)), ten));
+
+        __m128i hx[2];
+        hx[0] = _mm_mullo_epi32(xi, prime_x);
+        hx[1] = _mm_add_epi32(hx[0], prime_x);
+
+        __m128 n[8];
+        for (int32_t corner = 0; corner < 8; ++corner) {
+            const int32_t dx = corner & 1;
+            const int32_t dy = (corner >> 1) & 1;
+            const int32_t dz = corner >> 2;
+
+            __m128i hash = _mm_xor_si128(hx[dx], seeds[(dz << 1) | dy]);
+            hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 15));
+            hash = _mm_mullo_epi32(hash, prime_mix);
+            hash = _mm_xor_si128(hash, _mm_srli_epi32(hash, 12));
+
+            __m128 gx = _mm_xor_ps(fx[dx], _mm_castsi128_ps(_mm_slli_epi32(hash, 31)));
+            __m128 gy = _mm_xor_ps(fy[dy],
+                                   _mm_castsi128_ps(
+                                       _mm_and_si128(_mm_slli_epi32(hash, 30), sign_bit)));
+            __m128 gz = _mm_xor_ps(fz[dz],
+                                   _mm_castsi128_ps(
+                                       _mm_and_si128(_mm_slli_epi32(hash, 29), sign_bit)));
+            n[corner] = _mm_add_ps(_mm_add_ps(gx, gy), gz);
+        }
+
+        __m128 nx[4];
+        for (int32_t k = 0; k < 4; ++k)
+            nx[k] = _mm_add_ps(n[k * 2], _mm_mul_ps(u, _mm_sub_ps(n[k * 2 + 1], n[k * 2])));
+        __m128 ny0 = _mm_add_ps(nx[0], _mm_mul_ps(v, _mm_sub_ps(nx[1], nx[0])));
+        __m128 ny1 = _mm_add_ps(nx[2], _mm_mul_ps(v, _mm_sub_ps(nx[3], nx[2])));
+        __m128 noise = _mm_add_ps(ny0, _mm_mul_ps(w, _mm_sub_ps(ny1, ny0)));
+
+        __m128 value = _mm_mul_ps(_mm_mul_ps(noise, scale), amplitude);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), value));
+    }
+
+    addRowScalar(params, i, count, out);
+}
+
+__attribute__((target("avx2"))) static void addRowAvx2(const RowParams &params,
+                                                       int32_t count,
+                                                       float *out)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 six = _mm256_set1_ps(6.0f);
+    const __m256 fifteen = _mm256_set1_ps(15.0f);
+    const __m256 ten = _mm256_set1_ps(10.0f);
+    const __m256i sign_bit = _mm256_set1_epi32(SIGN_BIT);
+    const __m256i prime_x = _mm256_set1_epi32(PRIME_X);
+    const __m256i prime_mix = _mm256_set1_epi32(PRIME_MIX);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 start_x = _mm256_set1_ps(params.start_x);
+    const __m256 step_x = _mm256_set1_ps(params.step_x);
+    const __m256 scale = _mm256_set1_ps(NOISE_SCALE);
+    const __m256 amplitude = _mm256_set1_ps(params.amplitude);
+    const __m256 fy[2] = {_mm256_set1_ps(params.fy0), _mm256_set1_ps(params.fy1)};
+    const __m256 fz[2] = {_mm256_set1_ps(params.fz0), _mm256_set1_ps(params.fz1)};
+    const __m256 v = _mm256_set1_ps(params.v);
+    const __m256 w = _mm256_set1_ps(params.w);
+    const __m256i seeds[4] = {_mm256_set1_epi32(params.seeds[0]),
+                              _mm256_set1_epi32(params.seeds[1]),
+                              _mm256_set1_epi32(params.seeds[2]),
+                              _mm256_set1_epi32(params.seeds[3])};
+
+    int32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_add_epi32(_mm256_set1_epi32(i), lanes);
+        __m256 x = _mm256_add_ps(start_x, _mm256_mul_ps(_mm256_cvtepi32_ps(index), step_x));
+        __m256i xi = _mm256_cvttps_epi32(x);
+        // Adding the all ones compare mask subtracts one where truncation rounded up
+        xi = _mm256_add_epi32(
+            xi, _mm256_castps_si256(_mm256_cmp_ps(x, _mm256_cvtepi32_ps(xi), _CMP_LT_OQ)));
+        __m256 fx[2];
+        fx[0] = _mm256_sub_ps(x, _mm256_cvtepi32_ps(xi));
+        fx[1] = _mm256_sub_ps(fx[0], one);
+        __m256 u = _mm256_mul_ps(
+            _mm256_mul_ps(_mm256_mul_ps(fx[0], fx[0]), fx[0]),
+            _mm256_add_ps(_mm256_mul_ps(fx[0], _mm256_sub_ps(_mm256_mul_ps(fx[0], six), fifteen)),
+                          ten));
+
+        __m256i hx[2];
+        hx[0] = _mm256_mullo_epi32(xi, prime_x);
+        hx[1] = _mm256_add_epi32(hx[0], prime_x);
+
+        __m256 n[8];
+        for (int32_t corner = 0; corner < 8; ++corner) {
+            const int32_t dx = corner & 1;
+            const int32_t dy = (corner >> 1) & 1;
+            const int32_t dz = corner >> 2;
+
+            __m256i hash = _mm256_xor_si256(hx[dx], seeds[(dz << 1) | dy]);
+            hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 15));
+            hash = _mm256_mullo_epi32(hash, prime_mix);
+            hash = _mm256_xor_si256(hash, _mm256_srli_epi32(hash, 12));
+
+            __m256 gx = _mm256_xor_ps(fx[dx], _mm256_castsi256_ps(_mm256_slli_epi32(hash, 31)));
+            __m256 gy = _mm256_xor_ps(fy[dy],
+                                      _mm256_castsi256_ps(
+                                          _mm256_and_si256(_mm256_slli_epi32(hash, 30), sign_bit)));
+            __m256 gz = _mm256_xor_ps(fz[dz],
+                                      _mm256_castsi256_ps(
+                                          _mm256_and_si256(_mm256_slli_epi32(hash, 29), sign_bit)));
+            n[corner] = _mm256_add_ps(_mm256_add_ps(gx, gy), gz);
+        }
+
+        __m256 nx[4];
+        for (int32_t k = 0; k < 4; ++k)
+            nx[k] = _mm256_add_ps(n[k * 2],
+                                  _mm256_mul_ps(u, _mm256_sub_ps(n[k * 2 + 1], n[k * 2])));
+        __m256 ny0 = _mm256_add_ps(nx[0], _mm256_mul_ps(v, _mm256_sub_ps(nx[1], nx[0])));
+        __m256 ny1 = _mm256_add_ps(nx[2], _mm256_mul_ps(v, _mm256_sub_ps(nx[3], nx[2])));
+        __m256 noise = _mm256_add_ps(ny0, _mm256_mul_ps(w, _mm256_sub_ps(ny1, ny0)));
+
+        __m256 value = _mm256_mul_ps(_mm256_mul_ps(noise, scale), amplitude);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), value));
+    }
+
+    addRowScalar(params, i, count, out);
+}
+
+#endif // EB_NOISE_X86
+
+Noise::Noise(uint32_t seed)
+    : m_seed{seed}
+    , m_path{getBestPath()}
+{}
+
+uint32_t Noise::getSeed() const
+{
+    return m_seed;
+}
+
+void Noise::setSeed(uint32_t seed)
+{
+    m_seed = seed;
+}
+
+Noise::Path Noise::getPath() const
+{
+    return m_path;
+}
+
+void Noise::setPath(Path path)
+{
+    m_path = isPathSupported(path) ? path : getBestPath();
+}
+
+bool Noise::isPathSupported(Path path)
+{
+    switch (path) {
+    case Path::SCALAR:
+        return true;
+#ifdef EB_NOISE_X86
+    case Path::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case Path::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+Noise::Path Noise::getBestPath()
+{
+    if (isPathSupported(Path::AVX2))
+        return Path::AVX2;
+    if (isPathSupported(Path::SSE41))
+        return Path::SSE41;
+    return Path::SCALAR;
+}
+
+const char *Noise::getPathName(Path path)
+{
+    switch (path) {
+    case Path::SSE41:
+        return "SSE4.1";
+    case Path::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
+
+float Noise::get(const glm::vec3 &point) const
+{
+    float value = 0.0f;
+    addRowScalar(makeRowParams(point, 0.0f, 1.0f, m_seed), 0, 1, &value);
+    return value;
+}
+
+void Noise::getRow(const glm::vec3 &start, float step_x, int32_t count, float *out) const
+{
+    std::fill(out, out + count, 0.0f);
+    addRow(start, step_x, 1.0f, m_seed, count, out);
+}
+
+void Noise::getRowFbm(const glm::vec3 &start,
+                      float step_x,
+                      int32_t count,
+                      int32_t octaves,
+                      float lacunarity,
+                      float gain,
+                      float *out) const
+{
+    std::fill(out, out + count, 0.0f);
+
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    uint32_t seed = m_seed;
+    for (int32_t octave = 0; octave < octaves; ++octave) {
+        addRow(start * frequency, step_x * frequency, amplitude, seed, count, out);
+        frequency *= lacunarity;
+        amplitude *= gain;
+        seed += OCTAVE_SEED_STEP;
+    }
+}
+
+void Noise::benchmark(int32_t voxels_count) const
+{
+    const int32_t row_size = 256;
+    const int32_t rows_count = std::max(voxels_count / row_size, 1);
+
+    std::vector<float> reference(static_cast<size_t>(rows_count) * row_size);
+    std::vector<float> values(reference.size());
+
+    Noise noise{m_seed};
+    for (Path path : {Path::SCALAR, Path::SSE41, Path::AVX2}) {
+        if (!isPathSupported(path))
+            continue;
+
+        noise.setPath(path);
+        std::vector<float> &out = path == Path::SCALAR ? reference : values;
+
+        Clock clock;
+        for (int32_t row = 0; row < rows_count; ++row)
+            noise.getRowFbm(glm::vec3{0.123f, row * 0.0625f, row * 0.03125f},
+                            0.0625f,
+                            row_size,
+                            4,
+                            2.0f,
+                            0.5f,
+                            out.data() + static_cast<size_t>(row) * row_size);
+        float seconds = clock.getElapsedTime().asSeconds();
+
+        spdlog::info("Noise {}: {:.1f} Mvoxels/s (4 octaves)",
+                     getPathName(path),
+                     out.size() * 1e-6f / std::max(seconds, 1e-6f));
+
+        if (path != Path::SCALAR && values != reference)
+            spdlog::error("Noise {} output differs from scalar", getPathName(path));
+    }
+}
+
+void Noise::addRow(const glm::vec3 &start,
+                   float step_x,
+                   float amplitude,
+                   uint32_t seed,
+                   int32_t count,
+                   float *out) const
+{
+    RowParams params = makeRowParams(start, step_x, amplitude, seed);
+
+    switch (m_path) {
+#ifdef EB_NOISE_X86
+    case Path::AVX2:
+        addRowAvx2(params, count, out);
+        return;
+    case Path::SSE41:
+        addRowSse41(params, count, out);
+        return;
+#endif
+    default:
+        addRowScalar(params, 0, count, out);
+        return;
+    }
+}
+
+} // namespace eb
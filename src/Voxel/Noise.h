@@ -0,0 +1,66 @@
+#ifndef EB_VOXEL_NOISE_H
+#define EB_VOXEL_NOISE_H
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+
+namespace eb {
+
+// Seeded 3d gradient noise evaluated a row of points at a time.
+// Rows are computed with AVX2 or SSE4.1 when the cpu supports them and with
+// a scalar loop otherwise. All paths give bit for bit the same output.
+class Noise
+{
+public:
+    enum class Path { SCALAR, SSE41, AVX2 };
+
+    Noise(uint32_t seed = 0);
+    ~Noise() = default;
+
+    uint32_t getSeed() const;
+    void setSeed(uint32_t seed);
+
+    Path getPath() const;
+    // Falls back to the best supported path
+    void setPath(Path path);
+    static bool isPathSupported(Path path);
+    static Path getBestPath();
+    static const char *getPathName(Path path);
+
+    // Single point, roughly in [-1, 1]
+    float get(const glm::vec3 &point) const;
+
+    // out[i] = noise(start + {i * step_x, 0, 0}) for i in [0, count)
+    void getRow(const glm::vec3 &start, float step_x, int32_t count, float *out) const;
+
+    // Fractal sum of octaves, each octave scales frequency by lacunarity and
+    // amplitude by gain
+    void getRowFbm(const glm::vec3 &start,
+                   float step_x,
+                   int32_t count,
+                   int32_t octaves,
+                   float lacunarity,
+                   float gain,
+                   float *out) const;
+
+    // Logs voxels per second of every supported path and checks that they
+    // match the scalar output
+    void benchmark(int32_t voxels_count = 1 << 22) const;
+
+private:
+    void addRow(const glm::vec3 &start,
+                float step_x,
+                float amplitude,
+                uint32_t seed,
+                int32_t count,
+                float *out) const;
+
+private:
+    uint32_t m_seed;
+    Path m_path;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_NOISE_H
@@ -0,0 +1,249 @@
+#include "NoiseCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace eb {
+
+NoiseCache::NoiseCache(const Noise &noise,
+                       const glm::i32vec3 &chunk_size,
+                       int32_t chunks_height,
+                       const glm::i32vec3 &lattice_step,
+                       int32_t max_columns)
+    : m_noise{noise}
+    , m_chunk_size{chunk_size}
+    , m_chunks_height{std::max(chunks_height, 1)}
+    , m_requested_lattice_step{glm::max(lattice_step, glm::i32vec3{1})}
+    , m_lattice_step{glm::min(m_requested_lattice_step, getMaxLatticeStep(Field{}))}
+    , m_max_columns{std::max(max_columns, 1)}
+    , m_hits_count{0}
+    , m_misses_count{0}
+    , m_samples_count{0}
+{}
+
+const NoiseCache::Field &NoiseCache::getHeightField() const
+{
+    return m_height_field;
+}
+
+void NoiseCache::setHeightField(const Field &field)
+{
+    m_height_field = field;
+    clear();
+}
+
+const NoiseCache::Field &NoiseCache::getDensityField() const
+{
+    return m_density_field;
+}
+
+void NoiseCache::setDensityField(const Field &field)
+{
+    m_density_field = field;
+    m_lattice_step = glm::min(m_requested_lattice_step, getMaxLatticeStep(m_density_field));
+    clear();
+}
+
+const glm::i32vec3 &NoiseCache::getLatticeStep() const
+{
+    return m_lattice_step;
+}
+
+void NoiseCache::setLatticeStep(const glm::i32vec3 &lattice_step)
+{
+    m_requested_lattice_step = glm::max(lattice_step, glm::i32vec3{1});
+    m_lattice_step = glm::min(m_requested_lattice_step, getMaxLatticeStep(m_density_field));
+    clear();
+}
+
+glm::i32vec3 NoiseCache::getMaxLatticeStep(const Field &field)
+{
+    // Noise has about one feature per unit, the last octave is the finest
+    const float octaves_scale = std::pow(std::max(field.lacunarity, 1.0f),
+                                         static_cast<float>(std::max(field.octaves - 1, 0)));
+    glm::i32vec3 max_step;
+    for (int32_t i = 0; i < 3; ++i) {
+        const float frequency = std::abs(field.frequency[i]) * octaves_scale;
+        const float step = frequency > 0.0f ? 0.25f / frequency : 1024.0f;
+        max_step[i] = std::max(static_cast<int32_t>(std::min(step, 1024.0f)), 1);
+    }
+    return max_step;
+}
+
+int32_t NoiseCache::getMaxColumns() const
+{
+    return m_max_columns;
+}
+
+void NoiseCache::setMaxColumns(int32_t max_columns)
+{
+    m_max_columns = std::max(max_columns, 1);
+    clear();
+}
+
+void NoiseCache::clear()
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_columns.clear();
+    m_order.clear();
+}
+
+NoiseCache::Stats NoiseCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock{m_mutex};
+    Stats stats;
+    stats.columns_count = m_columns.getSize();
+    stats.memory_bytes = stats.columns_count * getColumnMemoryUsage();
+    const size_t heights_bytes = m_chunk_size.x * m_chunk_size.z * sizeof(float);
+    m_columns.forEach([&stats, heights_bytes](const glm::i32vec3 &,
+                                              const std::shared_ptr<const Column> &column) {
+        if (column->heights_built.load(std::memory_order_acquire))
+            stats.memory_bytes += heights_bytes;
+    });
+    stats.hits_count = m_hits_count;
+    stats.misses_count = m_misses_count;
+    stats.samples_count = m_samples_count;
+    return stats;
+}
+
+void NoiseCache::getHeights(const glm::i32vec3 &chunk_coords, float *out)
+{
+    auto column = getColumn(chunk_coords);
+    std::call_once(column->heights_once, [this, &chunk_coords, &column]() {
+        buildHeights({chunk_coords.x, chunk_coords.z}, column->heights);
+        column->heights_built.store(true, std::memory_order_release);
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_samples_count += column->heights.size();
+    });
+    std::copy(column->heights.begin(), column->heights.end(), out);
+}
+
+void NoiseCache::getDensity(const glm::i32vec3 &chunk_coords, float *out)
+{
+    auto column = getColumn(chunk_coords);
+    const glm::i32vec3 lattice_size = getLatticeSize();
+    const int32_t plane_size = lattice_size.x * lattice_size.z;
+
+    // Trilinear interpolation split by axis: the lattice planes around the
+    // voxel row are blended along y, then the lattice rows along z and the
+    // row is stretched along x. The blends run over contiguous floats.
+    PoolVector<float> plane(plane_size);
+    PoolVector<float> row(lattice_size.x);
+    for (int32_t y = 0; y < m_chunk_size.y; ++y) {
+        const int32_t voxel_y = chunk_coords.y * m_chunk_size.y + y;
+        const int32_t cell_y = std::clamp(voxel_y / m_lattice_step.y, 0, lattice_size.y - 2);
+        const float ty = static_cast<float>(voxel_y - cell_y * m_lattice_step.y)
+                         / m_lattice_step.y;
+        const float *bottom = column->density.data() + cell_y * plane_size;
+        const float *top = bottom + plane_size;
+        for (int32_t i = 0; i < plane_size; ++i)
+            plane[i] = bottom[i] + ty * (top[i] - bottom[i]);
+
+        for (int32_t z = 0; z < m_chunk_size.z; ++z) {
+            const int32_t cell_z = z / m_lattice_step.z;
+            const float tz = static_cast<float>(z - cell_z * m_lattice_step.z)
+                             / m_lattice_step.z;
+            const float *near = plane.data() + cell_z * lattice_size.x;
+            const float *far = near + lattice_size.x;
+            for (int32_t i = 0; i < lattice_size.x; ++i)
+                row[i] = near[i] + tz * (far[i] - near[i]);
+
+            float *out_row = out + (y * m_chunk_size.z + z) * m_chunk_size.x;
+            for (int32_t x = 0; x < m_chunk_size.x; ++x) {
+                const int32_t cell_x = x / m_lattice_step.x;
+                const float tx = static_cast<float>(x - cell_x * m_lattice_step.x)
+                                 / m_lattice_step.x;
+                out_row[x] = row[cell_x] + tx * (row[cell_x + 1] - row[cell_x]);
+            }
+        }
+    }
+}
+
+std::shared_ptr<const NoiseCache::Column> NoiseCache::getColumn(const glm::i32vec3 &chunk_coords)
+{
+    const glm::i32vec3 key{chunk_coords.x, 0, chunk_coords.z};
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (auto *column = m_columns.find(key)) {
+            ++m_hits_count;
+            return *column;
+        }
+        ++m_misses_count;
+    }
+
+    // Threads may build the same column at once, they get equal samples
+    auto column = makeSharedPooled<Column>();
+    buildColumn({chunk_coords.x, chunk_coords.z}, *column);
+
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (auto *cached = m_columns.find(key))
+        return *cached;
+
+    const glm::i32vec3 lattice_size = getLatticeSize();
+    m_samples_count += lattice_size.x * lattice_size.y * lattice_size.z;
+    m_columns.insert(key, std::shared_ptr<const Column>{column});
+    m_order.push_back(key);
+    while (static_cast<int32_t>(m_order.size()) > m_max_columns) {
+        m_columns.remove(m_order.front());
+        m_order.pop_front();
+    }
+    return column;
+}
+
+void NoiseCache::buildColumn(const glm::i32vec2 &column_coords, Column &column) const
+{
+    const glm::i32vec3 origin = glm::i32vec3{column_coords.x, 0, column_coords.y} * m_chunk_size;
+    const Field &density = m_density_field;
+    const glm::i32vec3 lattice_size = getLatticeSize();
+    column.density.resize(lattice_size.x * lattice_size.y * lattice_size.z);
+    for (int32_t y = 0; y < lattice_size.y; ++y) {
+        for (int32_t z = 0; z < lattice_size.z; ++z) {
+            m_noise.getRowFbm(glm::vec3{origin.x * density.frequency.x,
+                                        y * m_lattice_step.y * density.frequency.y,
+                                        (origin.z + z * m_lattice_step.z) * density.frequency.z},
+                              m_lattice_step.x * density.frequency.x,
+                              lattice_size.x,
+                              density.octaves,
+                              density.lacunarity,
+                              density.gain,
+                              column.density.data() + (y * lattice_size.z + z) * lattice_size.x);
+        }
+    }
+}
+
+void NoiseCache::buildHeights(const glm::i32vec2 &column_coords, PoolVector<float> &heights) const
+{
+    const glm::i32vec3 origin = glm::i32vec3{column_coords.x, 0, column_coords.y} * m_chunk_size;
+    const Field &height = m_height_field;
+    heights.resize(m_chunk_size.x * m_chunk_size.z);
+    for (int32_t z = 0; z < m_chunk_size.z; ++z) {
+        m_noise.getRowFbm(glm::vec3{origin.x * height.frequency.x,
+                                    0.0f,
+                                    (origin.z + z) * height.frequency.z},
+                          height.frequency.x,
+                          m_chunk_size.x,
+                          height.octaves,
+                          height.lacunarity,
+                          height.gain,
+                          heights.data() + z * m_chunk_size.x);
+    }
+}
+
+glm::i32vec3 NoiseCache::getLatticeSize() const
+{
+    // Cells cover the column, the last point may lie past its end
+    const glm::i32vec3 column_size{m_chunk_size.x,
+                                   m_chunk_size.y * m_chunks_height,
+                                   m_chunk_size.z};
+    return (column_size + m_lattice_step - 1) / m_lattice_step + 1;
+}
+
+size_t NoiseCache::getColumnMemoryUsage() const
+{
+    const glm::i32vec3 lattice_size = getLatticeSize();
+    // Heights are counted by getStats() once built
+    return sizeof(Column) + lattice_size.x * lattice_size.y * lattice_size.z * sizeof(float);
+}
+
+} // namespace eb
@@ -0,0 +1,122 @@
+#ifndef EB_VOXEL_NOISECACHE_H
+#define EB_VOXEL_NOISECACHE_H
+
+#include "../System/MemoryPool.h"
+#include "ChunkMap.h"
+#include "Noise.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+namespace eb {
+
+// Noise samples of chunk columns shared by the chunks of a column. Heights
+// come from a 2d field sampled once per voxel column on the first
+// getHeights() of the chunk column. Density comes from a 3d
+// field sampled on a coarse lattice and is interpolated between its points.
+// The lattice step is limited per axis to a quarter of the period of the
+// highest density octave, coarser lattices would alias the field.
+// Generators on any thread may read it, the oldest columns are dropped first.
+class NoiseCache
+{
+public:
+    // Fractal sum of octaves, frequency is per voxel and the 2d field only
+    // uses x and z
+    struct Field
+    {
+        glm::vec3 frequency{0.01f};
+        int32_t octaves = 3;
+        float lacunarity = 2.0f;
+        float gain = 0.5f;
+    };
+    struct Stats
+    {
+        int32_t columns_count = 0;
+        size_t memory_bytes = 0;
+        uint64_t hits_count = 0;
+        uint64_t misses_count = 0;
+        // Noise evaluations, a voxel evaluated per voxel would be one sample
+        uint64_t samples_count = 0;
+    };
+
+    // Chunks queue stacked chunks together, a column is read by all of them
+    // long before this many newer columns push it out
+    static constexpr int32_t DEFAULT_MAX_COLUMNS = 256;
+
+    // Columns cover the chunk heights [0, chunks_height)
+    NoiseCache(const Noise &noise,
+               const glm::i32vec3 &chunk_size,
+               int32_t chunks_height,
+               const glm::i32vec3 &lattice_step = glm::i32vec3{4},
+               int32_t max_columns = DEFAULT_MAX_COLUMNS);
+    ~NoiseCache() = default;
+
+    // Setters drop the cached columns, they must not be called while chunks
+    // are generated. Seed changes of the noise need a clear().
+    const Field &getHeightField() const;
+    void setHeightField(const Field &field);
+    const Field &getDensityField() const;
+    void setDensityField(const Field &field);
+    // Step in use, the requested step limited by the density field
+    const glm::i32vec3 &getLatticeStep() const;
+    void setLatticeStep(const glm::i32vec3 &lattice_step);
+    // Largest step that samples every octave of the field at least four
+    // times per period
+    static glm::i32vec3 getMaxLatticeStep(const Field &field);
+    int32_t getMaxColumns() const;
+    void setMaxColumns(int32_t max_columns);
+    void clear();
+
+    Stats getStats() const;
+
+    // chunk_size.x * chunk_size.z heights of the chunk column indexed by
+    // z * chunk_size.x + x
+    void getHeights(const glm::i32vec3 &chunk_coords, float *out);
+    // Density of every voxel of the chunk in the order of
+    // Chunk::voxelCoordsToIndex
+    void getDensity(const glm::i32vec3 &chunk_coords, float *out);
+
+private:
+    struct Column
+    {
+        // Lattice points indexed by (y * size.z + z) * size.x + x
+        PoolVector<float> density;
+        // Generators that never read heights do not pay for them
+        mutable std::once_flag heights_once;
+        mutable std::atomic<bool> heights_built{false};
+        mutable PoolVector<float> heights;
+    };
+
+    std::shared_ptr<const Column> getColumn(const glm::i32vec3 &chunk_coords);
+    void buildColumn(const glm::i32vec2 &column_coords, Column &column) const;
+    void buildHeights(const glm::i32vec2 &column_coords, PoolVector<float> &heights) const;
+    glm::i32vec3 getLatticeSize() const;
+    size_t getColumnMemoryUsage() const;
+
+private:
+    const Noise &m_noise;
+    glm::i32vec3 m_chunk_size;
+    int32_t m_chunks_height;
+    glm::i32vec3 m_requested_lattice_step;
+    glm::i32vec3 m_lattice_step;
+    int32_t m_max_columns;
+    Field m_height_field;
+    Field m_density_field;
+
+    mutable std::mutex m_mutex;
+    // Keyed by {x, 0, z} of the column, m_order holds them oldest first
+    ChunkMap<std::shared_ptr<const Column>> m_columns;
+    std::deque<glm::i32vec3> m_order;
+    uint64_t m_hits_count;
+    uint64_t m_misses_count;
+    uint64_t m_samples_count;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_NOISECACHE_H
@@ -0,0 +1,248 @@
+#include "RegionFile.h"
+#include "../Utils/VecUtils.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace eb {
+
+static const char REGION_MAGIC[4] = {'E', 'B', 'R', 'G'};
+static const uint32_t REGION_VERSION = 1;
+
+RegionFile::RegionFile(const std::filesystem::path &path)
+    : m_path{path}
+    , m_fd{-1}
+    , m_mapping{nullptr}
+    , m_mapping_size{0}
+    , m_file_size{0}
+    , m_entries_modified{false}
+{
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0) {
+        spdlog::error("Failed to open region file: {}", path.string());
+        return;
+    }
+
+    struct stat file_stat;
+    if (fstat(m_fd, &file_stat) != 0) {
+        spdlog::error("Failed to stat region file: {}", path.string());
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+    m_file_size = file_stat.st_size;
+
+    Header header{};
+    const size_t header_size = sectorsCount(sizeof(Header)) * SECTOR_SIZE;
+
+    if (m_file_size == 0) {
+        memcpy(header.magic, REGION_MAGIC, sizeof(REGION_MAGIC));
+        header.version = REGION_VERSION;
+
+        std::vector<uint8_t> header_data(header_size, 0);
+        memcpy(header_data.data(), &header, sizeof(Header));
+        if (pwrite(m_fd, header_data.data(), header_data.size(), 0)
+            != static_cast<ssize_t>(header_data.size())) {
+            spdlog::error("Failed to write region file header: {}", path.string());
+            ::close(m_fd);
+            m_fd = -1;
+            return;
+        }
+        m_file_size = header_size;
+    } else if (m_file_size < header_size
+               || pread(m_fd, &header, sizeof(Header), 0) != sizeof(Header)
+               || memcmp(header.magic, REGION_MAGIC, sizeof(REGION_MAGIC)) != 0
+               || header.version != REGION_VERSION) {
+        spdlog::error("Invalid region file: {}", path.string());
+        ::close(m_fd);
+        m_fd = -1;
+        return;
+    }
+
+    m_entries.assign(std::begin(header.entries), std::end(header.entries));
+    m_used_sectors.assign(sectorsCount(m_file_size), false);
+    setSectorsUsed({0, static_cast<uint32_t>(header_size)}, true);
+    for (const Entry &entry : m_entries)
+        setSectorsUsed(entry, true);
+    map();
+}
+
+RegionFile::~RegionFile()
+{
+    if (m_entries_modified && !sync())
+        spdlog::error("Failed to write region file table: {}", m_path.string());
+    unmap();
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+const std::filesystem::path &RegionFile::getPath() const
+{
+    return m_path;
+}
+
+bool RegionFile::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+bool RegionFile::hasChunk(const glm::i32vec3 &local_chunk_coords) const
+{
+    return isOpen() && m_entries[localCoordsToIndex(local_chunk_coords)].size != 0;
+}
+
+std::span<const uint8_t> RegionFile::readChunk(const glm::i32vec3 &local_chunk_coords)
+{
+    if (!isOpen())
+        return {};
+
+    const Entry &entry = m_entries[localCoordsToIndex(local_chunk_coords)];
+    if (entry.size == 0)
+        return {};
+
+    const size_t offset = static_cast<size_t>(entry.sector) * SECTOR_SIZE;
+    if (offset + entry.size > m_mapping_size) {
+        // File has grown since it was mapped
+        unmap();
+        if (!map() || offset + entry.size > m_mapping_size)
+            return {};
+    }
+
+    return {m_mapping + offset, entry.size};
+}
+
+bool RegionFile::writeChunk(const glm::i32vec3 &local_chunk_coords, std::span<const uint8_t> data)
+{
+    if (!isOpen() || data.empty())
+        return false;
+
+    const int32_t index = localCoordsToIndex(local_chunk_coords);
+    Entry entry{0, static_cast<uint32_t>(data.size())};
+    if (!allocateSectors(sectorsCount(entry.size), entry.sector))
+        return false;
+
+    if (pwrite(m_fd, data.data(), data.size(), static_cast<off_t>(entry.sector) * SECTOR_SIZE)
+        != static_cast<ssize_t>(data.size())) {
+        setSectorsUsed(entry, false);
+        return false;
+    }
+
+    if (m_entries[index].size != 0)
+        m_released_entries.push_back(m_entries[index]);
+    m_entries[index] = entry;
+    m_entries_modified = true;
+    return true;
+}
+
+bool RegionFile::sync()
+{
+    if (!isOpen())
+        return false;
+
+    // The table is written only over durable payloads, a crash at any point
+    // leaves entries pointing to the old or the new payloads
+    if (m_entries_modified) {
+        const ssize_t entries_size = m_entries.size() * sizeof(Entry);
+        if (fdatasync(m_fd) != 0
+            || pwrite(m_fd, m_entries.data(), entries_size, offsetof(Header, entries))
+                   != entries_size)
+            return false;
+        m_entries_modified = false;
+    }
+
+    if (fdatasync(m_fd) != 0)
+        return false;
+
+    for (const Entry &entry : m_released_entries)
+        setSectorsUsed(entry, false);
+    m_released_entries.clear();
+    return true;
+}
+
+glm::i32vec3 RegionFile::toRegionCoords(const glm::i32vec3 &chunk_coords)
+{
+    return {floorDiv(chunk_coords.x, SIZE), chunk_coords.y, floorDiv(chunk_coords.z, SIZE)};
+}
+
+glm::i32vec3 RegionFile::toLocalCoords(const glm::i32vec3 &chunk_coords)
+{
+    glm::i32vec3 region_coords = toRegionCoords(chunk_coords);
+    return {chunk_coords.x - region_coords.x * SIZE, 0, chunk_coords.z - region_coords.z * SIZE};
+}
+
+int32_t RegionFile::localCoordsToIndex(const glm::i32vec3 &local_chunk_coords)
+{
+    return local_chunk_coords.z * SIZE + local_chunk_coords.x;
+}
+
+uint32_t RegionFile::sectorsCount(uint32_t size)
+{
+    return (size + SECTOR_SIZE - 1) / SECTOR_SIZE;
+}
+
+bool RegionFile::allocateSectors(uint32_t count, uint32_t &sector)
+{
+    uint32_t free_count = 0;
+    for (uint32_t i = 0; i < m_used_sectors.size(); ++i) {
+        free_count = m_used_sectors[i] ? 0 : free_count + 1;
+        if (free_count == count) {
+            sector = i + 1 - count;
+            setSectorsUsed({sector, count * SECTOR_SIZE}, true);
+            return true;
+        }
+    }
+
+    // Free sectors at the end of the file are extended
+    sector = static_cast<uint32_t>(m_used_sectors.size()) - free_count;
+    const size_t file_size = static_cast<size_t>(sector + count) * SECTOR_SIZE;
+    if (ftruncate(m_fd, file_size) != 0)
+        return false;
+
+    m_file_size = file_size;
+    m_used_sectors.resize(sector + count);
+    setSectorsUsed({sector, count * SECTOR_SIZE}, true);
+    return true;
+}
+
+void RegionFile::setSectorsUsed(const Entry &entry, bool used)
+{
+    // Entries past the end of a truncated file are ignored
+    const uint32_t end = std::min<size_t>(static_cast<size_t>(entry.sector)
+                                              + sectorsCount(entry.size),
+                                          m_used_sectors.size());
+    for (uint32_t i = entry.sector; i < end; ++i)
+        m_used_sectors[i] = used;
+}
+
+bool RegionFile::map()
+{
+    if (m_fd < 0 || m_file_size == 0)
+        return false;
+
+    void *mapping = mmap(nullptr, m_file_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (mapping == MAP_FAILED) {
+        spdlog::error("Failed to map region file: {}", m_path.string());
+        return false;
+    }
+
+    m_mapping = static_cast<const uint8_t *>(mapping);
+    m_mapping_size = m_file_size;
+    return true;
+}
+
+void RegionFile::unmap()
+{
+    if (m_mapping)
+        munmap(const_cast<uint8_t *>(m_mapping), m_mapping_size);
+    m_mapping = nullptr;
+    m_mapping_size = 0;
+}
+
+} // namespace eb
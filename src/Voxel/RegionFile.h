@@ -0,0 +1,83 @@
+#ifndef EB_VOXEL_REGIONFILE_H
+#define EB_VOXEL_REGIONFILE_H
+
+#include "../Utils/NoCopyable.h"
+
+#include <glm/glm.hpp>
+
+#include <filesystem>
+#include <span>
+#include <stdint.h>
+#include <vector>
+
+namespace eb {
+
+// Region file groups SIZE x SIZE chunks of one chunk layer. The file starts
+// with an offset table followed by chunk payloads aligned to sectors.
+// Payloads are read straight from a read only memory mapping of the file.
+// Payloads are never overwritten in place: a chunk is written to free sectors
+// and the table on disk is only updated by sync(), once the payloads are
+// durable. The replaced sectors are reused after the new table is durable.
+class RegionFile : public NoCopyable
+{
+public:
+    static constexpr int32_t SIZE = 32;
+    static constexpr int32_t SECTOR_SIZE = 4096;
+
+    RegionFile(const std::filesystem::path &path);
+    ~RegionFile();
+
+    const std::filesystem::path &getPath() const;
+    bool isOpen() const;
+
+    bool hasChunk(const glm::i32vec3 &local_chunk_coords) const;
+    std::span<const uint8_t> readChunk(const glm::i32vec3 &local_chunk_coords);
+    bool writeChunk(const glm::i32vec3 &local_chunk_coords, std::span<const uint8_t> data);
+    // Writes the table of the written chunks once their payloads reach the
+    // disk, then frees the sectors of the payloads they replaced
+    bool sync();
+
+    static glm::i32vec3 toRegionCoords(const glm::i32vec3 &chunk_coords);
+    static glm::i32vec3 toLocalCoords(const glm::i32vec3 &chunk_coords);
+
+private:
+    struct Entry
+    {
+        uint32_t sector = 0;
+        uint32_t size = 0;
+    };
+
+    struct Header
+    {
+        char magic[4];
+        uint32_t version;
+        Entry entries[SIZE * SIZE];
+    };
+
+    static int32_t localCoordsToIndex(const glm::i32vec3 &local_chunk_coords);
+    static uint32_t sectorsCount(uint32_t size);
+
+    // First fit over the free sectors, grows the file when none fits
+    bool allocateSectors(uint32_t count, uint32_t &sector);
+    void setSectorsUsed(const Entry &entry, bool used);
+
+    bool map();
+    void unmap();
+
+private:
+    std::filesystem::path m_path;
+    int m_fd;
+    const uint8_t *m_mapping;
+    size_t m_mapping_size;
+    size_t m_file_size;
+    std::vector<Entry> m_entries;
+    // Entries differ from the table on disk
+    bool m_entries_modified;
+    std::vector<bool> m_used_sectors;
+    // Replaced payloads still referenced by the table on disk until sync()
+    std::vector<Entry> m_released_entries;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_REGIONFILE_H
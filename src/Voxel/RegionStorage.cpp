@@ -0,0 +1,134 @@
+#include "RegionStorage.h"
+#include "Chunk.h"
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+
+namespace eb {
+
+RegionStorage::RegionStorage(const std::filesystem::path &directory, int32_t max_open_files)
+    : m_directory{directory}
+    , m_max_open_files{std::max(max_open_files, 1)}
+    , m_use_counter{0}
+    , m_sync_failed{false}
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error)
+        spdlog::error("Failed to create world directory {}: {}",
+                      m_directory.string(),
+                      error.message());
+}
+
+const std::filesystem::path &RegionStorage::getDirectory() const
+{
+    return m_directory;
+}
+
+bool RegionStorage::hasChunk(const glm::i32vec3 &chunk_coords)
+{
+    RegionFile *region_file = getRegionFile(chunk_coords, false);
+    return region_file && region_file->hasChunk(RegionFile::toLocalCoords(chunk_coords));
+}
+
+bool RegionStorage::loadChunk(Chunk *chunk)
+{
+    RegionFile *region_file = getRegionFile(chunk->getPosition(), false);
+    if (!region_file)
+        return false;
+
+    auto data = region_file->readChunk(RegionFile::toLocalCoords(chunk->getPosition()));
+    if (data.empty())
+        return false;
+
+    if (!chunk->deserialize(data)) {
+        spdlog::warn("Corrupted chunk {} {} {} in {}",
+                     chunk->getPosition().x,
+                     chunk->getPosition().y,
+                     chunk->getPosition().z,
+                     region_file->getPath().string());
+        return false;
+    }
+
+    return true;
+}
+
+bool RegionStorage::saveChunk(Chunk *chunk)
+{
+    RegionFile *region_file = getRegionFile(chunk->getPosition(), true);
+    if (!region_file)
+        return false;
+
+    m_buffer.clear();
+    chunk->serialize(m_buffer);
+    if (!region_file->writeChunk(RegionFile::toLocalCoords(chunk->getPosition()), m_buffer))
+        return false;
+
+    chunk->m_unsaved = false;
+    return true;
+}
+
+bool RegionStorage::sync()
+{
+    bool result = !m_sync_failed;
+    m_sync_failed = false;
+    m_region_files.forEach([&result](const glm::i32vec3 &, OpenRegionFile &region_file) {
+        if (region_file.file->isOpen() && !region_file.file->sync()) {
+            spdlog::error("Failed to sync region file: {}", region_file.file->getPath().string());
+            result = false;
+        }
+    });
+    return result;
+}
+
+RegionFile *RegionStorage::getRegionFile(const glm::i32vec3 &chunk_coords, bool create)
+{
+    glm::i32vec3 region_coords = RegionFile::toRegionCoords(chunk_coords);
+
+    auto *region_file = m_region_files.find(region_coords);
+    if (region_file) {
+        region_file->last_use = ++m_use_counter;
+        return region_file->file->isOpen() ? region_file->file.get() : nullptr;
+    }
+
+    auto path = m_directory
+                / fmt::format("r.{}.{}.{}.region",
+                              region_coords.x,
+                              region_coords.y,
+                              region_coords.z);
+    if (!create && !std::filesystem::exists(path))
+        return nullptr;
+
+    if (m_region_files.getSize() >= m_max_open_files)
+        closeLeastRecentlyUsed();
+
+    auto &new_region_file = m_region_files.insert(region_coords,
+                                                  OpenRegionFile{std::make_unique<RegionFile>(path),
+                                                                 ++m_use_counter});
+    return new_region_file.file->isOpen() ? new_region_file.file.get() : nullptr;
+}
+
+void RegionStorage::closeLeastRecentlyUsed()
+{
+    glm::i32vec3 lru_coords{0};
+    uint64_t lru_use = UINT64_MAX;
+    m_region_files.forEach(
+        [&lru_coords, &lru_use](const glm::i32vec3 &region_coords, OpenRegionFile &region_file) {
+            if (region_file.last_use < lru_use) {
+                lru_use = region_file.last_use;
+                lru_coords = region_coords;
+            }
+        });
+
+    // Written chunks must reach the disk before the journal drops their edits
+    RegionFile *region_file = m_region_files.find(lru_coords)->file.get();
+    if (region_file->isOpen() && !region_file->sync()) {
+        spdlog::error("Failed to sync region file: {}", region_file->getPath().string());
+        m_sync_failed = true;
+    }
+    m_region_files.remove(lru_coords);
+}
+
+} // namespace eb
@@ -0,0 +1,57 @@
+#ifndef EB_VOXEL_REGIONSTORAGE_H
+#define EB_VOXEL_REGIONSTORAGE_H
+
+#include "ChunkMap.h"
+#include "RegionFile.h"
+
+#include <filesystem>
+#include <memory>
+#include <stdint.h>
+
+namespace eb {
+
+class Chunk;
+
+// Directory of region files, saves and loads chunks with their lightmaps.
+// At most max_open_files region files stay open, the least recently used one
+// is synced and closed to open another.
+class RegionStorage
+{
+public:
+    static constexpr int32_t DEFAULT_MAX_OPEN_FILES = 64;
+
+    RegionStorage(const std::filesystem::path &directory,
+                  int32_t max_open_files = DEFAULT_MAX_OPEN_FILES);
+    ~RegionStorage() = default;
+
+    const std::filesystem::path &getDirectory() const;
+
+    bool hasChunk(const glm::i32vec3 &chunk_coords);
+    bool loadChunk(Chunk *chunk);
+    bool saveChunk(Chunk *chunk);
+    // Waits for the saved chunks of every region file to reach the disk
+    bool sync();
+
+private:
+    struct OpenRegionFile
+    {
+        std::unique_ptr<RegionFile> file;
+        uint64_t last_use = 0;
+    };
+
+    RegionFile *getRegionFile(const glm::i32vec3 &chunk_coords, bool create);
+    void closeLeastRecentlyUsed();
+
+private:
+    std::filesystem::path m_directory;
+    int32_t m_max_open_files;
+    ChunkMap<OpenRegionFile> m_region_files;
+    uint64_t m_use_counter;
+    // A closed file failed to sync, the next sync() reports it
+    bool m_sync_failed;
+    std::vector<uint8_t> m_buffer;
+};
+
+} // namespace eb
+
+#endif // EB_VOXEL_REGIONSTORAGE_H
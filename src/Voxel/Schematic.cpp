@@ -0,0 +1,132 @@
+#include "Schematic.h"
+#include "../Utils/BinaryStream.h"
+
+#include <spdlog/spdlog.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace eb {
+
+static const char SCHEMATIC_MAGIC[4] = {'E', 'B', 'S', 'C'};
+static const uint32_t SCHEMATIC_VERSION = 1;
+// Keeps the voxel count in int32_t range
+static constexpr int32_t MAX_SCHEMATIC_SIZE = 1024;
+
+static int32_t volume(const glm::i32vec3 &size)
+{
+    return size.x * size.y * size.z;
+}
+
+Schematic::Schematic(const glm::i32vec3 &size)
+    : m_size{glm::clamp(size, glm::i32vec3{0}, glm::i32vec3{MAX_SCHEMATIC_SIZE})}
+    , m_voxels{volume(m_size)}
+{}
+
+const glm::i32vec3 &Schematic::getSize() const
+{
+    return m_size;
+}
+
+const VoxelStorage &Schematic::getVoxels() const
+{
+    return m_voxels;
+}
+
+bool Schematic::containsVoxel(const glm::i32vec3 &voxel_coords) const
+{
+    return voxel_coords.x >= 0 && voxel_coords.y >= 0 && voxel_coords.z >= 0
+           && voxel_coords.x < m_size.x && voxel_coords.y < m_size.y && voxel_coords.z < m_size.z;
+}
+
+void Schematic::setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel)
+{
+    if (containsVoxel(voxel_coords))
+        m_voxels.set(voxelCoordsToIndex(voxel_coords), voxel);
+}
+
+void Schematic::serialize(std::vector<uint8_t> &data) const
+{
+    BinaryWriter writer{data};
+    writer.writeBytes(SCHEMATIC_MAGIC, sizeof(SCHEMATIC_MAGIC));
+    writer.write(SCHEMATIC_VERSION);
+    writer.writeVarUInt(m_size.x);
+    writer.writeVarUInt(m_size.y);
+    writer.writeVarUInt(m_size.z);
+    m_voxels.serialize(writer);
+}
+
+bool Schematic::deserialize(std::span<const uint8_t> data)
+{
+    BinaryReader reader{data.data(), data.size()};
+    char magic[4];
+    reader.readBytes(magic, sizeof(magic));
+    const uint32_t version = reader.read<uint32_t>();
+    if (!reader.isValid() || memcmp(magic, SCHEMATIC_MAGIC, sizeof(magic)) != 0
+        || version != SCHEMATIC_VERSION)
+        return false;
+
+    glm::i32vec3 size;
+    for (int32_t i = 0; i < 3; ++i) {
+        const uint64_t value = reader.readVarUInt();
+        if (!reader.isValid() || value > MAX_SCHEMATIC_SIZE)
+            return false;
+        size[i] = static_cast<int32_t>(value);
+    }
+
+    VoxelStorage voxels{volume(size)};
+    if (!voxels.deserialize(reader))
+        return false;
+
+    m_size = size;
+    m_voxels = std::move(voxels);
+    return true;
+}
+
+bool Schematic::save(const std::filesystem::path &path) const
+{
+    std::vector<uint8_t> data;
+    serialize(data);
+
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+        spdlog::error("Failed to write schematic: {}", path.string());
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+
+    ::close(fd);
+    return true;
+}
+
+bool Schematic::load(const std::filesystem::path &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        spdlog::error("Failed to open schematic: {}", path.string());
+        return false;
+    }
+
+    struct stat file_stat;
+    void *mapping = MAP_FAILED;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0)
+        mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        spdlog::error("Failed to map schematic: {}", path.string());
+        return false;
+    }
+
+    const bool result = deserialize({static_cast<const uint8_t *>(mapping),
+                                     static_cast<size_t>(file_stat.st_size)});
+    munmap(mapping, file_stat.st_size);
+    if (!result)
+        spdlog::error("Invalid schematic: {}", path.string());
+    return result;
+}
+
+} // namespace eb
@@ -0,0 +1,57 @@
+#ifndef EB_VOXEL_SCHEMATIC_H
+#define EB_VOXEL_SCHEMATIC_H
+
+#include "VoxelStorage.h"
+
+#include <glm/glm.hpp>
+
+#include <filesystem>
+#include <span>
+#include <stdint.h>
+#include <vector>
+
+namespace eb {
+
+// Box of voxels pasted into the world as a prefab, see Chunks::stampSchematic().
+// Voxels are kept palette compressed and saved as the size followed by the
+// palette and run length encoded palette indices.
+class Schematic
+{
+public:
+    Schematic(const glm::i32vec3 &size = glm::i32vec3{0});
+    ~Schematic() = default;
+
+    const glm::i32vec3 &getSize() const;
+    const VoxelStorage &getVoxels() const;
+
+    // Same voxel order as Chunk::voxelCoordsToIndex
+    int32_t voxelCoordsToIndex(const glm::i32vec3 &voxel_coords) const;
+    bool containsVoxel(const glm::i32vec3 &voxel_coords) const;
+    const Voxel &getVoxel(const glm::i32vec3 &voxel_coords) const;
+    void setVoxel(const glm::i32vec3 &voxel_coords, const Voxel &voxel);
+
+    void serialize(std::vector<uint8_t> &data) const;
+    bool deserialize(std::span<const uint8_t> data);
+
+    bool save(const std::filesystem::path &path) const;
+    // Decodes straight from a read only memory mapping of the file
+    bool load(const std::filesystem::path &path);
+
+private:
+    glm::i32vec3 m_size;
+    VoxelStorage m_voxels;
+};
+
+inline int32_t Schematic::voxelCoordsToIndex(const glm::i32vec3 &voxel_coords) const
+{
+    return (voxel_coords.y * m_size.z + voxel_coords.z) * m_size.x + voxel_coords.x;
+}
+
+inline const Voxel &Schematic::getVoxel(const glm::i32vec3 &voxel_coords) const
+{
+    return m_voxels.get(voxelCoordsToIndex(voxel_coords));
+}
+
+} // namespace eb
+
+#endif // EB_VOXEL_SCHEMATIC_H
@@ -0,0 +1,28 @@
+#include "VoxelCursor.h"
+#include "Chunks.h"
+
+namespace eb {
+
+VoxelCursor::VoxelCursor(Chunks *chunks, const glm::i32vec3 &voxel_coords)
+    : m_chunks{chunks}
+    , m_chunk{nullptr}
+    , m_chunk_size{chunks->getChunkSize()}
+    , m_voxel_coords{voxel_coords}
+    , m_local_coords{0}
+{
+    m_chunk = findChunk(voxel_coords, m_local_coords);
+}
+
+void VoxelCursor::moveTo(const glm::i32vec3 &voxel_coords)
+{
+    m_chunk = findChunk(voxel_coords, m_local_coords);
+    m_voxel_coords = voxel_coords;
+}
+
+Chunk *VoxelCursor::findChunk(const glm::i32vec3 &voxel_coords, glm::i32vec3 &local_coords) const
+{
+    local_coords = m_chunks->toLocalCoords(voxel_coords);
+    return m_chunks->getChunkByVoxel(voxel_coords);
+}
+
+} // namespace eb
@@ -0,0 +1,144 @@
+#ifndef EB_VOXEL_VOXELCURSOR_H
+#define EB_VOXEL_VOXELCURSOR_H
+
+#include "Chunk.h"
+
+#include <glm/glm.hpp>
+
+#include <assert.h>
+#include <optional>
+#include <stdint.h>
+
+namespace eb {
+
+class Chunks;
+
+// Voxel position that remembers its chunk. Moves and reads by offsets of at
+// most one chunk size per axis cross chunk borders through the chunk
+// neighbour links instead of looking chunks up by voxel coords. Cursors must
+// not outlive an unload of their chunk.
+class VoxelCursor
+{
+public:
+    VoxelCursor(Chunks *chunks, const glm::i32vec3 &voxel_coords);
+    VoxelCursor(Chunks *chunks, Chunk *chunk, const glm::i32vec3 &local_coords);
+    ~VoxelCursor() = default;
+
+    const glm::i32vec3 &getVoxelCoords() const;
+    const glm::i32vec3 &getLocalCoords() const;
+    // nullptr when the voxel is not loaded
+    Chunk *getChunk() const;
+
+    void moveTo(const glm::i32vec3 &voxel_coords);
+    void move(const glm::i32vec3 &offset);
+    VoxelCursor getMoved(const glm::i32vec3 &offset) const;
+
+    std::optional<Voxel> getVoxel() const;
+    uint8_t getLight(int32_t channel) const;
+
+    // Reads the voxel at offset without moving
+    std::optional<Voxel> getVoxel(const glm::i32vec3 &offset) const;
+    uint8_t getLight(const glm::i32vec3 &offset, int32_t channel) const;
+
+private:
+    // Chunk of the voxel at offset and its local coords in it
+    Chunk *resolve(const glm::i32vec3 &offset, glm::i32vec3 &local_coords) const;
+    // Slow path for cursors outside loaded chunks
+    Chunk *findChunk(const glm::i32vec3 &voxel_coords, glm::i32vec3 &local_coords) const;
+
+private:
+    Chunks *m_chunks;
+    Chunk *m_chunk;
+    glm::i32vec3 m_chunk_size;
+    glm::i32vec3 m_voxel_coords;
+    glm::i32vec3 m_local_coords;
+};
+
+inline VoxelCursor::VoxelCursor(Chunks *chunks, Chunk *chunk, const glm::i32vec3 &local_coords)
+    : m_chunks{chunks}
+    , m_chunk{chunk}
+    , m_chunk_size{chunk->getSize()}
+    , m_voxel_coords{chunk->getPosition() * chunk->getSize() + local_coords}
+    , m_local_coords{local_coords}
+{}
+
+inline const glm::i32vec3 &VoxelCursor::getVoxelCoords() const
+{
+    return m_voxel_coords;
+}
+
+inline const glm::i32vec3 &VoxelCursor::getLocalCoords() const
+{
+    return m_local_coords;
+}
+
+inline Chunk *VoxelCursor::getChunk() const
+{
+    return m_chunk;
+}
+
+inline void VoxelCursor::move(const glm::i32vec3 &offset)
+{
+    m_chunk = resolve(offset, m_local_coords);
+    m_voxel_coords += offset;
+}
+
+inline VoxelCursor VoxelCursor::getMoved(const glm::i32vec3 &offset) const
+{
+    VoxelCursor cursor = *this;
+    cursor.move(offset);
+    return cursor;
+}
+
+inline std::optional<Voxel> VoxelCursor::getVoxel() const
+{
+    if (!m_chunk)
+        return std::nullopt;
+    return m_chunk->getVoxels().get(m_chunk->voxelCoordsToIndex(m_local_coords));
+}
+
+inline uint8_t VoxelCursor::getLight(int32_t channel) const
+{
+    return m_chunk ? m_chunk->getLightmap().get(m_local_coords, channel) : 0;
+}
+
+inline std::optional<Voxel> VoxelCursor::getVoxel(const glm::i32vec3 &offset) const
+{
+    glm::i32vec3 local_coords;
+    const Chunk *chunk = resolve(offset, local_coords);
+    if (!chunk)
+        return std::nullopt;
+    return chunk->getVoxels().get(chunk->voxelCoordsToIndex(local_coords));
+}
+
+inline uint8_t VoxelCursor::getLight(const glm::i32vec3 &offset, int32_t channel) const
+{
+    glm::i32vec3 local_coords;
+    Chunk *chunk = resolve(offset, local_coords);
+    return chunk ? chunk->getLightmap().get(local_coords, channel) : 0;
+}
+
+inline Chunk *VoxelCursor::resolve(const glm::i32vec3 &offset, glm::i32vec3 &local_coords) const
+{
+    if (!m_chunk)
+        return findChunk(m_voxel_coords + offset, local_coords);
+
+    local_coords = m_local_coords + offset;
+    glm::i32vec3 chunk_offset{0};
+    for (int32_t i = 0; i < 3; ++i) {
+        assert(local_coords[i] >= -m_chunk_size[i] && local_coords[i] < 2 * m_chunk_size[i]);
+        if (local_coords[i] < 0) {
+            chunk_offset[i] = -1;
+            local_coords[i] += m_chunk_size[i];
+        } else if (local_coords[i] >= m_chunk_size[i]) {
+            chunk_offset[i] = 1;
+            local_coords[i] -= m_chunk_size[i];
+        }
+    }
+
+    return chunk_offset == glm::i32vec3{0} ? m_chunk : m_chunk->getNeighbour(chunk_offset);
+}
+
+} // namespace eb
+
+#endif // EB_VOXEL_VOXELCURSOR_H
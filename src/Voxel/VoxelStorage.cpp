@@ -0,0 +1,230 @@
+#include "VoxelStorage.h"
+#include "../Utils/BinaryStream.h"
+
+#include <assert.h>
+
+namespace eb {
+
+static int32_t wordsCount(int32_t size, int32_t bits)
+{
+    return (static_cast<int64_t>(size) * bits + 63) / 64;
+}
+
+VoxelStorage::VoxelStorage(int32_t size)
+    : m_size{size}
+    , m_bits{0}
+    , m_mask{0}
+{
+    m_palette.push_back(Voxel{0});
+    m_palette_counts.push_back(size);
+}
+
+int32_t VoxelStorage::getSize() const
+{
+    return m_size;
+}
+
+int32_t VoxelStorage::getBits() const
+{
+    return m_bits;
+}
+
+const PoolVector<Voxel> &VoxelStorage::getPalette() const
+{
+    return m_palette;
+}
+
+bool VoxelStorage::isUniform() const
+{
+    return m_bits == 0;
+}
+
+void VoxelStorage::set(int32_t index, const Voxel &voxel)
+{
+    uint32_t old_palette_index = getIndex(index);
+    if (m_palette[old_palette_index].id == voxel.id)
+        return;
+
+    int32_t palette_index = getPaletteIndex(voxel);
+    --m_palette_counts[old_palette_index];
+    ++m_palette_counts[palette_index];
+
+    if (m_palette_counts[palette_index] == m_size)
+        collapse(palette_index);
+    else
+        setIndex(index, palette_index);
+}
+
+int32_t VoxelStorage::getCount(const Voxel &voxel) const
+{
+    for (int32_t i = 0; i < m_palette.size(); ++i) {
+        if (m_palette[i].id == voxel.id)
+            return m_palette_counts[i];
+    }
+    return 0;
+}
+
+int32_t VoxelStorage::fill(const Voxel &voxel)
+{
+    const int32_t changed_count = m_size - getCount(voxel);
+
+    m_palette.assign(1, voxel);
+    m_palette_counts.assign(1, m_size);
+
+    m_bits = 0;
+    m_mask = 0;
+    m_data.clear();
+    m_data.shrink_to_fit();
+
+    return changed_count;
+}
+
+size_t VoxelStorage::getMemoryUsage() const
+{
+    return sizeof(VoxelStorage) + m_palette.capacity() * sizeof(Voxel)
+           + m_palette_counts.capacity() * sizeof(int32_t)
+           + m_data.capacity() * sizeof(uint64_t);
+}
+
+void VoxelStorage::serialize(BinaryWriter &writer) const
+{
+    writer.writeVarUInt(m_palette.size());
+    for (const auto &voxel : m_palette)
+        writer.writeVarInt(voxel.id);
+
+    int32_t index = 0;
+    while (index < m_size) {
+        uint32_t palette_index = getIndex(index);
+        int32_t run_end = index + 1;
+        while (run_end < m_size && getIndex(run_end) == palette_index)
+            ++run_end;
+
+        writer.writeVarUInt(palette_index);
+        writer.writeVarUInt(run_end - index);
+        index = run_end;
+    }
+}
+
+bool VoxelStorage::deserialize(BinaryReader &reader)
+{
+    uint64_t palette_size = reader.readVarUInt();
+    if (!reader.isValid() || palette_size == 0 || palette_size > (uint64_t{1} << MAX_BITS))
+        return false;
+
+    PoolVector<Voxel> palette(palette_size);
+    for (auto &voxel : palette)
+        voxel.id = static_cast<int32_t>(reader.readVarInt());
+
+    m_palette = std::move(palette);
+    m_palette_counts.assign(m_palette.size(), 0);
+    m_bits = 0;
+    m_mask = 0;
+    m_data.clear();
+
+    int32_t bits = 0;
+    while ((size_t{1} << bits) < m_palette.size())
+        ++bits;
+    if (bits > 0)
+        repack(bits);
+
+    int32_t index = 0;
+    while (index < m_size && reader.isValid()) {
+        uint64_t palette_index = reader.readVarUInt();
+        uint64_t length = reader.readVarUInt();
+        if (palette_index >= m_palette.size() || length == 0 || length > m_size - index)
+            break;
+
+        m_palette_counts[palette_index] += length;
+        if (m_bits == 0) {
+            index += length;
+            continue;
+        }
+
+        for (int32_t end = index + length; index < end; ++index)
+            setIndex(index, palette_index);
+    }
+
+    if (!reader.isValid() || index != m_size) {
+        *this = VoxelStorage{m_size};
+        return false;
+    }
+
+    for (int32_t i = 0; i < m_palette.size(); ++i) {
+        if (m_palette_counts[i] == m_size) {
+            collapse(i);
+            break;
+        }
+    }
+
+    return true;
+}
+
+int32_t VoxelStorage::getPaletteIndex(const Voxel &voxel)
+{
+    int32_t free_index = -1;
+    for (int32_t i = 0; i < m_palette.size(); ++i) {
+        if (m_palette[i].id == voxel.id)
+            return i;
+        if (free_index < 0 && m_palette_counts[i] == 0)
+            free_index = i;
+    }
+
+    // Reuse palette entries which are no longer referenced
+    if (free_index >= 0) {
+        m_palette[free_index] = voxel;
+        return free_index;
+    }
+
+    m_palette.push_back(voxel);
+    m_palette_counts.push_back(0);
+
+    if (m_palette.size() > (size_t{1} << m_bits))
+        repack(m_bits + 1);
+
+    return m_palette.size() - 1;
+}
+
+void VoxelStorage::setIndex(int32_t index, uint32_t palette_index)
+{
+    const int64_t bit = static_cast<int64_t>(index) * m_bits;
+    const int64_t word = bit >> 6;
+    const int32_t offset = bit & 63;
+    const uint64_t value = palette_index & m_mask;
+
+    m_data[word] = (m_data[word] & ~(m_mask << offset)) | (value << offset);
+    if (offset + m_bits > 64) {
+        const int32_t shift = 64 - offset;
+        m_data[word + 1] = (m_data[word + 1] & ~(m_mask >> shift)) | (value >> shift);
+    }
+}
+
+void VoxelStorage::repack(int32_t bits)
+{
+    assert(bits <= MAX_BITS);
+
+    if (m_bits == 0) {
+        m_bits = bits;
+        m_mask = (uint64_t{1} << m_bits) - 1;
+        m_data.assign(wordsCount(m_size, m_bits), 0);
+        return;
+    }
+
+    PoolVector<uint32_t> indices(m_size);
+    for (int32_t i = 0; i < m_size; ++i)
+        indices[i] = getIndex(i);
+
+    m_bits = bits;
+    m_mask = (uint64_t{1} << m_bits) - 1;
+    m_data.assign(wordsCount(m_size, m_bits), 0);
+
+    for (int32_t i = 0; i < m_size; ++i)
+        setIndex(i, indices[i]);
+}
+
+void VoxelStorage::collapse(int32_t palette_index)
+{
+    Voxel voxel = m_palette[palette_index];
+    fill(voxel);
+}
+
+} // namespace eb
@@ -0,0 +1,113 @@
+#ifndef EB_VOXEL_VOXELSTORAGE_H
+#define EB_VOXEL_VOXELSTORAGE_H
+
+#include "../System/MemoryPool.h"
+#include "Voxel.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace eb {
+
+class BinaryReader;
+class BinaryWriter;
+
+// Palette compressed voxel array: every voxel stores a 1-16 bit index into
+// a per storage palette, indices are tightly packed into 64 bit words.
+// Storage filled with a single voxel is uniform and keeps no index data.
+class VoxelStorage
+{
+public:
+    static constexpr int32_t MAX_BITS = 16;
+
+    VoxelStorage(int32_t size);
+    ~VoxelStorage() = default;
+
+    int32_t getSize() const;
+    int32_t getBits() const;
+    const PoolVector<Voxel> &getPalette() const;
+    bool isUniform() const;
+
+    const Voxel &get(int32_t index) const;
+    void set(int32_t index, const Voxel &voxel);
+
+    // Calls func(index, voxel) for every voxel in index order, indices are
+    // decoded sequentially instead of one lookup per voxel
+    template<typename F>
+    void forEach(F &&func) const
+    {
+        if (m_bits == 0) {
+            for (int32_t i = 0; i < m_size; ++i)
+                func(i, m_palette.front());
+            return;
+        }
+
+        int32_t offset = 0;
+        const uint64_t *word = m_data.data();
+        for (int32_t i = 0; i < m_size; ++i) {
+            uint64_t value = *word >> offset;
+            offset += m_bits;
+            if (offset >= 64) {
+                offset -= 64;
+                ++word;
+                if (offset > 0)
+                    value |= *word << (m_bits - offset);
+            }
+            func(i, m_palette[value & m_mask]);
+        }
+    }
+
+    // Number of voxels equal to the given one
+    int32_t getCount(const Voxel &voxel) const;
+    // Makes the storage uniform, returns the number of changed voxels
+    int32_t fill(const Voxel &voxel);
+
+    size_t getMemoryUsage() const;
+
+    // Palette followed by run length encoded palette indices
+    void serialize(BinaryWriter &writer) const;
+    bool deserialize(BinaryReader &reader);
+
+private:
+    int32_t getPaletteIndex(const Voxel &voxel);
+
+    uint32_t getIndex(int32_t index) const;
+    void setIndex(int32_t index, uint32_t palette_index);
+
+    void repack(int32_t bits);
+    void collapse(int32_t palette_index);
+
+private:
+    int32_t m_size;
+    int32_t m_bits;
+    uint64_t m_mask;
+    PoolVector<Voxel> m_palette;
+    PoolVector<int32_t> m_palette_counts;
+    PoolVector<uint64_t> m_data;
+};
+
+inline const Voxel &VoxelStorage::get(int32_t index) const
+{
+    return m_palette[getIndex(index)];
+}
+
+inline uint32_t VoxelStorage::getIndex(int32_t index) const
+{
+    if (m_bits == 0)
+        return 0;
+
+    const int64_t bit = static_cast<int64_t>(index) * m_bits;
+    const int64_t word = bit >> 6;
+    const int32_t offset = bit & 63;
+
+    uint64_t value = m_data[word] >> offset;
+    if (offset + m_bits > 64)
+        value |= m_data[word + 1] << (64 - offset);
+
+    return static_cast<uint32_t>(value & m_mask);
+}
+
+} // namespace eb
+
+#endif // EB_VOXEL_VOXELSTORAGE_H
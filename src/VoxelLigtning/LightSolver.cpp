@@ -17,64 +17,69 @@ void LightSolver::add(const glm::i32vec3 &coords, int32_t emission)
 {
     if (emission <= 1)
         return;
-    LightEntry entry;
-    entry.position = coords;
-    entry.light = emission;
-    m_add_queue.push(entry);
 
-    Chunk *chunk = m_chunks->getChunkByVoxel(coords);
+    const VoxelCursor cursor{m_chunks, coords};
+    Chunk *chunk = cursor.getChunk();
+    if (chunk == nullptr)
+        return;
+
+    m_add_queue.push(LightEntry{cursor, static_cast<uint16_t>(emission)});
+
     chunk->m_modified = true;
-    chunk->getLightmap().set(coords % m_chunks->getChunkSize(), m_channel, entry.light);
+    chunk->m_unsaved = true;
+    chunk->getMutableLightmap().set(cursor.getLocalCoords(), m_channel, emission);
+}
+
+void LightSolver::addEmission(const glm::i32vec3 &coords)
+{
+    auto voxel = m_chunks->getVoxel(coords);
+    if (voxel)
+        add(coords, m_chunks->getBlockRegistry().getEmission(voxel->id, m_channel));
 }
 
 void LightSolver::remove(const glm::i32vec3 &coords)
 {
-    Chunk *chunk = m_chunks->getChunkByVoxel(coords);
+    const VoxelCursor cursor{m_chunks, coords};
+    Chunk *chunk = cursor.getChunk();
     if (chunk == nullptr)
         return;
 
-    int32_t light = chunk->getLightmap().get(coords % m_chunks->getChunkSize(), m_channel);
+    int32_t light = cursor.getLight(m_channel);
     if (light == 0) {
         return;
     }
 
-    LightEntry entry;
-    entry.position = coords;
-    entry.light = light;
-    m_remove_queue.push(entry);
+    m_remove_queue.push(LightEntry{cursor, static_cast<uint16_t>(light)});
 
-    chunk->getLightmap().set(coords % m_chunks->getChunkSize(), m_channel, 0);
+    chunk->getMutableLightmap().set(cursor.getLocalCoords(), m_channel, 0);
+    chunk->m_unsaved = true;
 }
 
 void LightSolver::solve()
 {
-    static const int32_t coords[] = {0, 0, 1, 0, 0, -1, 0, 1, 0, 0, -1, 0, 1, 0, 0, -1, 0, 0};
+    static const glm::i32vec3 neighbours[6]
+        = {{0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0}};
+
+    const BlockRegistry &block_registry = m_chunks->getBlockRegistry();
 
+    // Neighbours are reached through the chunk links of the entry cursors
     while (!m_remove_queue.empty()) {
         LightEntry entry = m_remove_queue.front();
         m_remove_queue.pop();
 
-        for (size_t i = 0; i < 6; i++) {
-            glm::i32vec3 voxel_coords = entry.position
-                                        + glm::i32vec3{coords[i * 3 + 0],
-                                                       coords[i * 3 + 1],
-                                                       coords[i * 3 + 2]};
-
-            Chunk *chunk = m_chunks->getChunkByVoxel(voxel_coords);
+        for (const auto &offset : neighbours) {
+            const VoxelCursor cursor = entry.cursor.getMoved(offset);
+            Chunk *chunk = cursor.getChunk();
             if (chunk) {
-                int32_t light = m_chunks->getLight(voxel_coords, m_channel);
-                if (light != 0 && light == entry.light - 1) {
-                    LightEntry nentry;
-                    nentry.position = voxel_coords;
-                    nentry.light = light;
-                    m_remove_queue.push(nentry);
-                    chunk->getLightmap().set(voxel_coords % m_chunks->getChunkSize(), m_channel, 0);
+                int32_t light = cursor.getLight(m_channel);
+                // Light below the removed one may have come from it
+                if (light != 0 && light < entry.light) {
+                    m_remove_queue.push(LightEntry{cursor, static_cast<uint16_t>(light)});
+                    chunk->getMutableLightmap().set(cursor.getLocalCoords(), m_channel, 0);
                     chunk->m_modified = true;
+                    chunk->m_unsaved = true;
                 } else if (light >= entry.light) {
-                    LightEntry nentry;
-                    nentry.position = voxel_coords;
-                    nentry.light = light;
-                    m_add_queue.push(nentry);
+                    m_add_queue.push(LightEntry{cursor, static_cast<uint16_t>(light)});
                 }
             }
         }
@@ -87,24 +92,24 @@ void LightSolver::solve()
         if (entry.light <= 1)
             continue;
 
-        for (size_t i = 0; i < 6; i++) {
-            glm::i32vec3 voxel_coords = entry.position
-                                        + glm::i32vec3{coords[i * 3 + 0],
-                                                       coords[i * 3 + 1],
-                                                       coords[i * 3 + 2]};
-            Chunk *chunk = m_chunks->getChunkByVoxel(voxel_coords);
+        for (const auto &offset : neighbours) {
+            const VoxelCursor cursor = entry.cursor.getMoved(offset);
+            Chunk *chunk = cursor.getChunk();
+
+            // Light never enters uniform opaque chunks
+            if (chunk && chunk->isUniform()
+                && block_registry.isOpaque(chunk->getUniformVoxel().id))
+                continue;
+
             if (chunk) {
-                int32_t light = m_chunks->getLight(voxel_coords, m_channel);
-                auto *voxel = m_chunks->getVoxel(voxel_coords);
-                if (voxel->id == 0 && light + 2 <= entry.light) {
-                    chunk->getLightmap().set(voxel_coords % m_chunks->getChunkSize(),
-                                             m_channel,
-                                             entry.light - 1);
+                int32_t light = cursor.getLight(m_channel);
+                auto voxel = cursor.getVoxel();
+                int32_t new_light = entry.light - block_registry.getAttenuation(voxel->id);
+                if (!block_registry.isOpaque(voxel->id) && new_light > light) {
+                    chunk->getMutableLightmap().set(cursor.getLocalCoords(), m_channel, new_light);
                     chunk->m_modified = true;
-                    LightEntry nentry;
-                    nentry.position = voxel_coords;
-                    nentry.light = entry.light - 1;
-                    m_add_queue.push(nentry);
+                    chunk->m_unsaved = true;
+                    m_add_queue.push(LightEntry{cursor, static_cast<uint16_t>(new_light)});
                 }
             }
         }
@@ -1,6 +1,8 @@
 #ifndef EB_VOXELLIGHTNING_LIGHTSOLVER_H
 #define EB_VOXELLIGHTNING_LIGHTSOLVER_H
 
+#include "../Voxel/VoxelCursor.h"
+
 #include <glm/glm.hpp>
 
 #include <queue>
@@ -12,7 +14,7 @@ class Chunks;
 
 struct LightEntry
 {
-    glm::i32vec3 position;
+    VoxelCursor cursor;
     uint16_t light;
 };
 
@@ -24,6 +26,8 @@ public:
 
     void add(const glm::i32vec3 &coords);
     void add(const glm::i32vec3 &coords, int32_t emission);
+    // Adds the emission of the voxel block type in the solver channel
+    void addEmission(const glm::i32vec3 &coords);
     void remove(const glm::i32vec3 &coords);
     void solve();
 
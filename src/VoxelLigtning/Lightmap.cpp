@@ -1,81 +1,159 @@
 #include "Lightmap.h"
+#include "../Utils/BinaryStream.h"
+
+#include <algorithm>
 
 namespace eb {
 
 Lightmap::Lightmap(const glm::i32vec3 &chunk_size)
     : m_chunk_size{chunk_size}
-{
-    m_map.resize(chunk_size.x * chunk_size.y * chunk_size.y, 0);
-}
-
-uint8_t Lightmap::get(const glm::i32vec3 &coords, int32_t channel) const
-{
-    return (m_map[coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z + coords.x]
-            >> (channel << 2))
-           & 0xF;
-}
+    , m_uniform_value{0}
+{}
 
 uint8_t Lightmap::getR(const glm::i32vec3 &coords) const
 {
-    return m_map[coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z + coords.x]
-           & 0xF;
+    return getValue(coords) & 0xF;
 }
 
 uint8_t Lightmap::getG(const glm::i32vec3 &coords) const
 {
-    return (m_map[coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z + coords.x]
-            >> 4)
-           & 0xF;
+    return (getValue(coords) >> 4) & 0xF;
 }
 
 uint8_t Lightmap::getB(const glm::i32vec3 &coords) const
 {
-    return (m_map[coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z + coords.x]
-            >> 8)
-           & 0xF;
+    return (getValue(coords) >> 8) & 0xF;
 }
 
 uint8_t Lightmap::getS(const glm::i32vec3 &coords) const
 {
-    return (m_map[coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z + coords.x]
-            >> 12)
-           & 0xF;
+    return (getValue(coords) >> 12) & 0xF;
 }
 
 void Lightmap::setR(const glm::i32vec3 &coords, int32_t value)
 {
-    const int32_t index = coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z
-                          + coords.x;
-    m_map[index] = (m_map[index] & 0xFFF0) | value;
+    setValue(coords, 0xFFF0, value);
 }
 
 void Lightmap::setG(const glm::i32vec3 &coords, int32_t value)
 {
-    const int32_t index = coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z
-                          + coords.x;
-    m_map[index] = (m_map[index] & 0xFF0F) | (value << 4);
+    setValue(coords, 0xFF0F, value << 4);
 }
 
 void Lightmap::setB(const glm::i32vec3 &coords, int32_t value)
 {
-    const int32_t index = coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z
-                          + coords.x;
-    m_map[index] = (m_map[index] & 0xF0FF) | (value << 8);
+    setValue(coords, 0xF0FF, value << 8);
 }
 
 void Lightmap::setS(const glm::i32vec3 &coords, int32_t value)
 {
-    const int32_t index = coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z
-                          + coords.x;
-    m_map[index] = (m_map[index] & 0x0FFF) | (value << 12);
+    setValue(coords, 0x0FFF, value << 12);
 }
 
 void Lightmap::set(const glm::i32vec3 &coords, int32_t channel, int32_t value)
 {
-    const int32_t index = coords.y * m_chunk_size.y * m_chunk_size.z + coords.z * m_chunk_size.z
-                          + coords.x;
-    m_map[index] = (m_map[index] & (0xFFFF & (~(0xF << (channel * 4)))))
-                   | (value << (channel << 2));
+    setValue(coords, 0xFFFF & (~(0xF << (channel << 2))), value << (channel << 2));
+}
+
+bool Lightmap::isUniform() const
+{
+    return m_map.empty();
+}
+
+uint16_t Lightmap::getUniformValue() const
+{
+    return m_uniform_value;
+}
+
+void Lightmap::fill(uint16_t value)
+{
+    m_uniform_value = value;
+    m_map.clear();
+    m_map.shrink_to_fit();
+}
+
+bool Lightmap::collapse()
+{
+    if (m_map.empty())
+        return true;
+
+    for (uint16_t value : m_map) {
+        if (value != m_map.front())
+            return false;
+    }
+
+    fill(m_map.front());
+    return true;
+}
+
+size_t Lightmap::getMemoryUsage() const
+{
+    return sizeof(Lightmap) + m_map.capacity() * sizeof(uint16_t);
+}
+
+void Lightmap::serialize(BinaryWriter &writer) const
+{
+    if (m_map.empty()) {
+        writer.writeVarUInt(m_uniform_value);
+        writer.writeVarUInt(m_chunk_size.x * m_chunk_size.y * m_chunk_size.z);
+        return;
+    }
+
+    size_t index = 0;
+    while (index < m_map.size()) {
+        size_t run_end = index + 1;
+        while (run_end < m_map.size() && m_map[run_end] == m_map[index])
+            ++run_end;
+
+        writer.writeVarUInt(m_map[index]);
+        writer.writeVarUInt(run_end - index);
+        index = run_end;
+    }
+}
+
+bool Lightmap::deserialize(BinaryReader &reader)
+{
+    const uint64_t size = m_chunk_size.x * m_chunk_size.y * m_chunk_size.z;
+
+    uint64_t value = reader.readVarUInt();
+    uint64_t length = reader.readVarUInt();
+    if (!reader.isValid() || value > 0xFFFF || length == 0 || length > size) {
+        fill(0);
+        return false;
+    }
+
+    if (length == size) {
+        fill(value);
+        return true;
+    }
+
+    m_map.resize(size);
+    uint64_t index = 0;
+    while (true) {
+        std::fill(m_map.begin() + index, m_map.begin() + index + length, value);
+        index += length;
+        if (index == size)
+            return true;
+
+        value = reader.readVarUInt();
+        length = reader.readVarUInt();
+        if (!reader.isValid() || value > 0xFFFF || length == 0 || length > size - index) {
+            fill(0);
+            return false;
+        }
+    }
+}
+
+void Lightmap::setValue(const glm::i32vec3 &coords, uint16_t mask, uint16_t value)
+{
+    if (m_map.empty()) {
+        if (((m_uniform_value & mask) | value) == m_uniform_value)
+            return;
+        m_map.resize(m_chunk_size.x * m_chunk_size.y * m_chunk_size.z, m_uniform_value);
+    }
+
+    const int32_t index = coordsToIndex(coords);
+    m_map[index] = (m_map[index] & mask) | value;
 }
 
 } // namespace eb
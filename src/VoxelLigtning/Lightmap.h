@@ -1,6 +1,9 @@
 #ifndef EB_VOXELLIGHTNING_LIGHTMAP_H
 #define EB_VOXELLIGHTNING_LIGHTMAP_H
 
+#include "../System/MemoryPool.h"
+
+#include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
@@ -8,6 +11,9 @@
 
 namespace eb {
 
+class BinaryReader;
+class BinaryWriter;
+
 class Lightmap
 {
 public:
@@ -26,11 +32,44 @@ public:
     void setS(const glm::i32vec3 &coords, int32_t value);
     void set(const glm::i32vec3 &coords, int32_t channel, int32_t value);
 
+    // Uniform lightmap keeps one value for the whole chunk and no array
+    bool isUniform() const;
+    uint16_t getUniformValue() const;
+    void fill(uint16_t value);
+    bool collapse();
+
+    size_t getMemoryUsage() const;
+
+    // Run length encoded light values
+    void serialize(BinaryWriter &writer) const;
+    bool deserialize(BinaryReader &reader);
+
+private:
+    int32_t coordsToIndex(const glm::i32vec3 &coords) const;
+    uint16_t getValue(const glm::i32vec3 &coords) const;
+    void setValue(const glm::i32vec3 &coords, uint16_t mask, uint16_t value);
+
 private:
     glm::i32vec3 m_chunk_size;
-    std::vector<uint16_t> m_map;
+    uint16_t m_uniform_value;
+    PoolVector<uint16_t> m_map;
 };
 
+inline uint8_t Lightmap::get(const glm::i32vec3 &coords, int32_t channel) const
+{
+    return (getValue(coords) >> (channel << 2)) & 0xF;
+}
+
+inline int32_t Lightmap::coordsToIndex(const glm::i32vec3 &coords) const
+{
+    return (coords.y * m_chunk_size.z + coords.z) * m_chunk_size.x + coords.x;
+}
+
+inline uint16_t Lightmap::getValue(const glm::i32vec3 &coords) const
+{
+    return m_map.empty() ? m_uniform_value : m_map[coordsToIndex(coords)];
+}
+
 } // namespace eb
 
 #endif // EB_VOXELLIGHTNING_LIGHTMAP_H
@@ -129,27 +129,28 @@ protected:
         // m_b_solver = std::make_unique<eb::LightSolver>(m_chunks.get(), 2);
         // m_s_solver = std::make_unique<eb::LightSolver>(m_chunks.get(), 3);
 
+        // eb::BlockType lamp;
+        // lamp.name = "lamp";
+        // lamp.emission = {15, 15, 15};
+        // lamp.face_tiles = {2, 2, 2, 2, 2, 2};
+        // m_chunks->getBlockRegistry().set(3, lamp);
+
         // m_chunks->forEachVoxels(
         //     [this](const glm::i32vec3 &voxel_coords_in_chunk, const glm::i32vec3 &voxel_coords) {
-        //         auto *voxel = m_chunks->getVoxel(voxel_coords);
-        //         if (voxel->id == 3) {
-        //             m_r_solver->add(voxel_coords, 15);
-        //             m_g_solver->add(voxel_coords, 15);
-        //             m_b_solver->add(voxel_coords, 15);
-        //         }
+        //         m_r_solver->addEmission(voxel_coords);
+        //         m_g_solver->addEmission(voxel_coords);
+        //         m_b_solver->addEmission(voxel_coords);
         //     });
 
         // glm::i32vec3 voxels_size = m_chunks->getChunkSize() * m_chunks->getChunksSize();
         // glm::i32vec3 voxel_coords;
         // for (voxel_coords.z = 0; voxel_coords.z < voxels_size.z; ++voxel_coords.z) {
         //     for (voxel_coords.x = 0; voxel_coords.x < voxels_size.x; ++voxel_coords.x) {
-        //         for (voxel_coords.y = voxels_size.y - 1; voxel_coords.y >= 0; --voxel_coords.y) {
-        //             auto *voxel = m_chunks->getVoxel(voxel_coords);
-        //             if (voxel->id != 0)
-        //                 break;
-
+        //         const int32_t height = m_chunks->getHeight({voxel_coords.x, voxel_coords.z});
+        //         for (voxel_coords.y = voxels_size.y - 1; voxel_coords.y >= height;
+        //              --voxel_coords.y) {
         //             m_chunks->getChunkByVoxel(voxel_coords)
-        //                 ->getLightmap()
+        //                 ->getMutableLightmap()
         //                 .setS(voxel_coords % m_chunks->getChunkSize(), 0xF);
         //         }
         //     }
@@ -157,11 +158,9 @@ protected:
 
         // for (voxel_coords.z = 0; voxel_coords.z < voxels_size.z; ++voxel_coords.z) {
         //     for (voxel_coords.x = 0; voxel_coords.x < voxels_size.x; ++voxel_coords.x) {
-        //         for (voxel_coords.y = voxels_size.y - 1; voxel_coords.y >= 0; --voxel_coords.y) {
-        //             auto *voxel = m_chunks->getVoxel(voxel_coords);
-        //             if (voxel->id != 0)
-        //                 break;
-
+        //         const int32_t height = m_chunks->getHeight({voxel_coords.x, voxel_coords.z});
+        //         for (voxel_coords.y = voxels_size.y - 1; voxel_coords.y >= height;
+        //              --voxel_coords.y) {
         //             if (m_chunks->getLight(voxel_coords + glm::i32vec3{-1, 0, 0}, 3) == 0
         //                 || m_chunks->getLight(voxel_coords + glm::i32vec3{1, 0, 0}, 3) == 0
         //                 || m_chunks->getLight(voxel_coords + glm::i32vec3{0, -1, 0}, 3) == 0
@@ -172,7 +171,7 @@ protected:
         //             }
 
         //             m_chunks->getChunkByVoxel(voxel_coords)
-        //                 ->getLightmap()
+        //                 ->getMutableLightmap()
         //                 .setS(voxel_coords % m_chunks->getChunkSize(), 0xF);
         //         }
         //     }
@@ -348,12 +347,12 @@ protected:
         //     glm::vec3 end;
         //     glm::vec3 norm;
         //     glm::vec3 iend;
-        //     const eb::Voxel *voxel = m_chunks->rayCast(m_scene_camera.camera->getPosition(),
-        //                                                m_scene_camera.camera->getFront(),
-        //                                                10.0f,
-        //                                                end,
-        //                                                norm,
-        //                                                iend);
+        //     auto voxel = m_chunks->rayCast(m_scene_camera.camera->getPosition(),
+        //                                    m_scene_camera.camera->getFront(),
+        //                                    10.0f,
+        //                                    end,
+        //                                    norm,
+        //                                    iend);
 
         //     if (voxel) {
         //         m_target_block_visible = true;